@@ -0,0 +1,520 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <fstream>
+#include <iostream>
+#include <malloc.h>
+#include <map>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include "alloc.h"
+#include "frames.h"
+
+extern "C" {
+void *__libc_malloc(size_t);
+void *__libc_calloc(size_t, size_t);
+void *__libc_realloc(void *, size_t);
+void *__libc_memalign(size_t, size_t);
+void *__libc_valloc(size_t);
+void *__libc_pvalloc(size_t);
+void __libc_free(void *);
+}
+
+#define PROFILER_TLS __thread __attribute__((tls_model("initial-exec")))
+
+static const size_t ProfileThreads = 32;
+static const size_t ProfileSamples = 256;
+static const size_t ProfileFrames = 16;
+static const size_t LiveSlots = 1 << 16;
+static const size_t LiveProbes = 32;
+static const size_t FilterBits = 14;
+
+struct AllocSample {
+    const char *scope;
+    size_t weight;
+    uint32_t depth;
+    void *frames[ProfileFrames];
+};
+
+// Everything malloc touches is constant-initialized, since the loader and
+// other libraries allocate before any of our constructors have run.
+struct ThreadProfile {
+    std::atomic<bool> claimed;
+    std::atomic<uint32_t> head;
+    std::atomic<uint32_t> tail;
+    std::atomic<uint64_t> sampled;
+    std::atomic<uint64_t> sampledBytes;
+    std::atomic<uint64_t> dropped;
+    AllocSample samples[ProfileSamples];
+};
+
+// Sampled allocations that are still live, so a free can take back the
+// sample's weight. Unsampled pointers are never counted either way, which
+// keeps the estimate sound for memory allocated before we were enabled.
+// A counting filter in front of the table lets nearly every free return
+// after one byte load.
+struct LiveSlot {
+    std::atomic<void*> ptr;
+    std::atomic<uint64_t> weight;
+};
+
+static void * const Tombstone = (void*)1;
+
+static ThreadProfile s_threads[ProfileThreads];
+static LiveSlot s_live[LiveSlots];
+static std::atomic<uint8_t> s_filter[1 << FilterBits];
+static std::atomic<int64_t> s_liveBytes;
+static std::atomic<uint64_t> s_liveOverflow;
+static bool s_enabled;
+static int64_t s_interval = 512 * 1024;
+static float s_dumpTimer;
+
+static PROFILER_TLS const char *t_scope;
+static PROFILER_TLS uint64_t t_children;
+static PROFILER_TLS bool t_busy;
+static PROFILER_TLS int64_t t_untilSample;
+static PROFILER_TLS ThreadProfile *t_profile;
+static PROFILER_TLS bool t_noProfile;
+
+__attribute__((constructor)) static void InitAllocProfiler()
+{
+    const char *enabled = getenv("HACK_ALLOC_PROFILE");
+    const char *interval = getenv("HACK_ALLOC_SAMPLE");
+    if(interval && atoll(interval) > 0)
+        s_interval = atoll(interval);
+
+    // backtrace() loads libgcc_s on first use, which allocates; do it now.
+    void *frame;
+    backtrace(&frame, 1);
+    s_enabled = enabled && *enabled && *enabled != '0';
+}
+
+static ThreadProfile * GetThreadProfile()
+{
+    if(t_profile || t_noProfile)
+        return t_profile;
+
+    for(ThreadProfile &candidate : s_threads)
+    {
+        bool expected = false;
+        if(candidate.claimed.compare_exchange_strong(expected, true))
+        {
+            t_profile = &candidate;
+            return t_profile;
+        }
+    }
+    t_noProfile = true;
+    return nullptr;
+}
+
+// Counters are only written by their owning thread, so a relaxed load and
+// store is enough and avoids a locked instruction.
+static inline void Bump(std::atomic<uint64_t> &counter, uint64_t amount)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+static inline size_t HashPointer(void *p, size_t bits)
+{
+    return ((uintptr_t)p * 0x9e3779b97f4a7c15ull) >> (64 - bits);
+}
+
+static void TrackLive(void *p, uint64_t weight)
+{
+    size_t start = HashPointer(p, 16);
+    for(size_t probe = 0; probe < LiveProbes; probe++)
+    {
+        LiveSlot &slot = s_live[(start + probe) % LiveSlots];
+        void *current = slot.ptr.load(std::memory_order_relaxed);
+        if(current != nullptr && current != Tombstone)
+            continue;
+        if(!slot.ptr.compare_exchange_strong(current, p, std::memory_order_acq_rel))
+            continue;
+
+        slot.weight.store(weight, std::memory_order_relaxed);
+        s_liveBytes.fetch_add(weight, std::memory_order_relaxed);
+
+        // Saturated filter counters stay saturated rather than wrap.
+        std::atomic<uint8_t> &filter = s_filter[HashPointer(p, FilterBits)];
+        uint8_t count = filter.load(std::memory_order_relaxed);
+        while(count < 255 && !filter.compare_exchange_weak(count, count + 1, std::memory_order_release));
+        return;
+    }
+    s_liveOverflow.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void ForgetLive(void *p)
+{
+    size_t start = HashPointer(p, 16);
+    for(size_t probe = 0; probe < LiveProbes; probe++)
+    {
+        LiveSlot &slot = s_live[(start + probe) % LiveSlots];
+        void *current = slot.ptr.load(std::memory_order_acquire);
+        if(current == nullptr)
+            return;
+        if(current != p)
+            continue;
+
+        s_liveBytes.fetch_sub(slot.weight.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        slot.ptr.store(Tombstone, std::memory_order_release);
+
+        std::atomic<uint8_t> &filter = s_filter[HashPointer(p, FilterBits)];
+        uint8_t count = filter.load(std::memory_order_relaxed);
+        while(count > 0 && count < 255 && !filter.compare_exchange_weak(count, count - 1, std::memory_order_relaxed));
+        return;
+    }
+}
+
+__attribute__((noinline)) static void RecordSample(void *p, size_t size)
+{
+    t_untilSample += s_interval;
+    if(t_untilSample < 0)
+        t_untilSample = s_interval;
+
+    ThreadProfile *profile = GetThreadProfile();
+    if(!profile)
+        return;
+
+    uint64_t weight = (int64_t)size > s_interval ? size : s_interval;
+    Bump(profile->sampled, 1);
+    Bump(profile->sampledBytes, weight);
+    TrackLive(p, weight);
+
+    uint32_t head = profile->head.load(std::memory_order_relaxed);
+    if(head - profile->tail.load(std::memory_order_acquire) >= ProfileSamples)
+    {
+        Bump(profile->dropped, 1);
+        return;
+    }
+
+    AllocSample &sample = profile->samples[head % ProfileSamples];
+    void *frames[ProfileFrames + 2];
+    int depth = backtrace(frames, ProfileFrames + 2);
+    depth = depth > 2 ? depth - 2 : 0;
+    memcpy(sample.frames, frames + 2, depth * sizeof(void*));
+    sample.depth = depth;
+    sample.scope = t_scope;
+    sample.weight = weight;
+    profile->head.store(head + 1, std::memory_order_release);
+}
+
+// The whole per-call cost when enabled: a thread-local countdown, and for
+// frees one filter byte. Everything else happens once per sample.
+static inline void OnAlloc(void *p, size_t size)
+{
+    t_untilSample -= size;
+    if(__builtin_expect(t_untilSample < 0, 0) && !t_busy)
+    {
+        t_busy = true;
+        RecordSample(p, size);
+        t_busy = false;
+    }
+}
+
+static inline void OnFree(void *p)
+{
+    if(s_filter[HashPointer(p, FilterBits)].load(std::memory_order_acquire) && !t_busy)
+    {
+        t_busy = true;
+        ForgetLive(p);
+        t_busy = false;
+    }
+}
+
+static inline void *Allocate(size_t size)
+{
+    void *p = __libc_malloc(size);
+    if(s_enabled && p)
+        OnAlloc(p, size);
+    return p;
+}
+
+static inline void *AllocateAligned(size_t alignment, size_t size)
+{
+    void *p = __libc_memalign(alignment, size);
+    if(s_enabled && p)
+        OnAlloc(p, size);
+    return p;
+}
+
+static inline void Release(void *p)
+{
+    if(s_enabled && p)
+        OnFree(p);
+    __libc_free(p);
+}
+
+extern "C" void *malloc(size_t size)
+{
+    return Allocate(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+    void *p = __libc_calloc(count, size);
+    if(s_enabled && p)
+        OnAlloc(p, count * size);
+    return p;
+}
+
+extern "C" void *realloc(void *old, size_t size)
+{
+    if(s_enabled && old)
+        OnFree(old);
+    void *p = __libc_realloc(old, size);
+    if(s_enabled && p)
+        OnAlloc(p, size);
+    return p;
+}
+
+extern "C" void *memalign(size_t alignment, size_t size)
+{
+    return AllocateAligned(alignment, size);
+}
+
+extern "C" void *aligned_alloc(size_t alignment, size_t size)
+{
+    return AllocateAligned(alignment, size);
+}
+
+extern "C" int posix_memalign(void **out, size_t alignment, size_t size)
+{
+    if(alignment == 0 || alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0)
+        return EINVAL;
+
+    void *p = AllocateAligned(alignment, size);
+    if(!p)
+        return ENOMEM;
+    *out = p;
+    return 0;
+}
+
+extern "C" void *valloc(size_t size)
+{
+    void *p = __libc_valloc(size);
+    if(s_enabled && p)
+        OnAlloc(p, size);
+    return p;
+}
+
+extern "C" void *pvalloc(size_t size)
+{
+    void *p = __libc_pvalloc(size);
+    if(s_enabled && p)
+        OnAlloc(p, size);
+    return p;
+}
+
+extern "C" void free(void *p)
+{
+    Release(p);
+}
+
+void *operator new(size_t size)
+{
+    void *p = Allocate(size ? size : 1);
+    if(!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    return Allocate(size ? size : 1);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+    return Allocate(size ? size : 1);
+}
+
+void *operator new(size_t size, std::align_val_t alignment)
+{
+    void *p = AllocateAligned((size_t)alignment, size ? size : 1);
+    if(!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](size_t size, std::align_val_t alignment)
+{
+    return operator new(size, alignment);
+}
+
+void *operator new(size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+    return AllocateAligned((size_t)alignment, size ? size : 1);
+}
+
+void *operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+    return AllocateAligned((size_t)alignment, size ? size : 1);
+}
+
+void operator delete(void *p) noexcept
+{
+    Release(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    Release(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    Release(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+    Release(p);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept
+{
+    Release(p);
+}
+
+void operator delete[](void *p, std::align_val_t) noexcept
+{
+    Release(p);
+}
+
+void operator delete(void *p, size_t, std::align_val_t) noexcept
+{
+    Release(p);
+}
+
+void operator delete[](void *p, size_t, std::align_val_t) noexcept
+{
+    Release(p);
+}
+
+static uint64_t NowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+ProfileScope::ProfileScope(const char *name)
+    : m_name(name), m_previous(t_scope), m_start(NowNs()), m_outerChildren(t_children)
+{
+    t_scope = name;
+    t_children = 0;
+}
+
+ProfileScope::~ProfileScope()
+{
+    uint64_t elapsed = NowNs() - m_start;
+    g_frames.AddHookTime(m_name, elapsed - std::min(elapsed, t_children));
+    t_scope = m_previous;
+    t_children = m_outerChildren + elapsed;
+}
+
+bool AllocProfiler::IsEnabled()
+{
+    return s_enabled;
+}
+
+static std::string Symbolize(void *address, std::unordered_map<void*, std::string> &cache)
+{
+    auto cached = cache.find(address);
+    if(cached != cache.end())
+        return cached->second;
+
+    std::string name;
+    Dl_info info;
+    bool found = dladdr(address, &info);
+    if(found && info.dli_sname)
+    {
+        int status = 0;
+        char *demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+        name = status == 0 && demangled ? demangled : info.dli_sname;
+        free(demangled);
+    }
+    else if(found && info.dli_fname)
+    {
+        const char *module = strrchr(info.dli_fname, '/');
+        name = std::string(module ? module + 1 : info.dli_fname) + "+" + std::to_string((uintptr_t)address - (uintptr_t)info.dli_fbase);
+    }
+    else
+        name = "??";
+
+    // ';' separates frames in the folded format.
+    for(char &c : name)
+    {
+        if(c == ';')
+            c = ':';
+    }
+    cache[address] = name;
+    return name;
+}
+
+void AllocProfiler::Dump(const char *path)
+{
+    static std::map<std::string, uint64_t> folded;
+    static std::unordered_map<void*, std::string> symbols;
+
+    // Our own bookkeeping below allocates; keep it out of the samples.
+    bool busy = t_busy;
+    t_busy = true;
+
+    uint64_t sampled = 0, sampledBytes = 0, dropped = 0;
+    for(ThreadProfile &profile : s_threads)
+    {
+        if(!profile.claimed.load(std::memory_order_acquire))
+            continue;
+
+        sampled += profile.sampled.load(std::memory_order_relaxed);
+        sampledBytes += profile.sampledBytes.load(std::memory_order_relaxed);
+        dropped += profile.dropped.load(std::memory_order_relaxed);
+
+        uint32_t tail = profile.tail.load(std::memory_order_relaxed);
+        uint32_t head = profile.head.load(std::memory_order_acquire);
+        for(; tail != head; tail++)
+        {
+            const AllocSample &sample = profile.samples[tail % ProfileSamples];
+            std::string stack = sample.scope ? sample.scope : "game";
+            for(uint32_t i = sample.depth; i-- > 0; )
+                stack += ";" + Symbolize(sample.frames[i], symbols);
+            folded[stack] += sample.weight;
+        }
+        profile.tail.store(tail, std::memory_order_release);
+    }
+
+    std::ofstream out(path);
+    for(auto &entry : folded)
+        out << entry.first << ' ' << entry.second << '\n';
+    out.close();
+
+    std::cout << "alloc " << sampled << " samples, ~" << sampledBytes << " bytes allocated, ~"
+        << s_liveBytes.load(std::memory_order_relaxed) << " bytes live in sampled allocations, " << dropped
+        << " stacks dropped, " << s_liveOverflow.load(std::memory_order_relaxed) << " untracked" << std::endl;
+    t_busy = busy;
+}
+
+void AllocProfiler::Tick(float delta)
+{
+    if(!s_enabled)
+        return;
+
+    s_dumpTimer += delta;
+    if(s_dumpTimer >= 10.0f)
+    {
+        s_dumpTimer = 0;
+        Dump("alloc.folded");
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Sampling allocation profiler. The malloc family, including the aligned
+// entry points, and every global new/delete are interposed for the whole
+// process, but unless HACK_ALLOC_PROFILE is set in the environment they
+// forward straight to glibc after a single flag test. When enabled, roughly
+// one sample per HACK_ALLOC_SAMPLE bytes (default 512K) records a backtrace
+// into the allocating thread's ring, tagged with the innermost ProfileScope;
+// unsampled calls only pay for a thread-local countdown. Live bytes are
+// estimated from sampled allocations that haven't been freed yet.
+// AllocProfiler::Tick drains the rings and rewrites alloc.folded, one
+// "scope;outer;...;inner bytes" line per stack, ready for flamegraph.pl.
+//
+// ProfileScope also times its own body, minus any nested scopes, and reports
+// that self-time to the frame monitor under the scope's name.
+class ProfileScope {
+    const char *m_name;
+    const char *m_previous;
+    uint64_t m_start;
+    uint64_t m_outerChildren;
+
+  public:
+    explicit ProfileScope(const char *name);
+    ~ProfileScope();
+};
+
+class AllocProfiler {
+  public:
+    static bool IsEnabled();
+    static void Tick(float delta);
+    static void Dump(const char *path);
+};
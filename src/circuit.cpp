@@ -0,0 +1,282 @@
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include "circuit.h"
+
+static const uint32_t NoSignal = 0xffffffff;
+
+static const uint64_t LanePatterns[6] = {
+    0xaaaaaaaaaaaaaaaaull, 0xccccccccccccccccull, 0xf0f0f0f0f0f0f0f0ull,
+    0xff00ff00ff00ff00ull, 0xffff0000ffff0000ull, 0xffffffff00000000ull
+};
+
+Circuit::Circuit() : m_inputCount(0)
+{
+}
+
+uint32_t Circuit::Lookup(const std::string &name) const
+{
+    auto it = m_signals.find(name);
+    if(it != m_signals.end())
+        return it->second;
+
+    if(name.size() > 1 && name[0] == 'i' && name.find_first_not_of("0123456789", 1) == std::string::npos)
+    {
+        uint32_t index = std::stoul(name.substr(1));
+        if(index < m_inputCount)
+            return index;
+    }
+    return NoSignal;
+}
+
+bool Circuit::Load(const std::string &path)
+{
+    static const std::map<std::string, Op> ops = {
+        {"and", And}, {"or", Or}, {"xor", Xor}, {"nand", Nand},
+        {"nor", Nor}, {"xnor", Xnor}, {"not", Not}, {"buf", Buf}
+    };
+
+    std::ifstream in(path);
+    if(!in)
+        return false;
+
+    m_inputCount = 0;
+    m_gates.clear();
+    m_outputs.clear();
+    m_signals.clear();
+
+    std::string line;
+    while(std::getline(in, line))
+    {
+        std::stringstream ss(line.substr(0, line.find('#')));
+        std::string name, op, a, b;
+        if(!(ss >> name))
+            continue;
+
+        if(name == "inputs")
+        {
+            ss >> m_inputCount;
+            if(m_inputCount > 32 || !m_gates.empty())
+                return false;
+            continue;
+        }
+        if(name == "output")
+        {
+            ss >> a;
+            uint32_t signal = this->Lookup(a);
+            if(signal == NoSignal)
+                return false;
+            m_outputs.push_back(signal);
+            continue;
+        }
+
+        ss >> op >> a >> b;
+        auto found = ops.find(op);
+        if(found == ops.end() || m_signals.count(name))
+            return false;
+
+        Gate gate;
+        gate.op = found->second;
+        gate.a = this->Lookup(a);
+        gate.b = gate.op == Not || gate.op == Buf ? gate.a : this->Lookup(b);
+        if(gate.a == NoSignal || gate.b == NoSignal)
+            return false;
+
+        m_signals[name] = m_inputCount + m_gates.size();
+        m_gates.push_back(gate);
+    }
+    return m_outputs.size() > 0;
+}
+
+size_t Circuit::GetInputCount() const
+{
+    return m_inputCount;
+}
+
+size_t Circuit::GetOutputCount() const
+{
+    return m_outputs.size();
+}
+
+uint64_t Circuit::Apply(const Gate &gate, const std::vector<uint64_t> &signals) const
+{
+    uint64_t a = signals[gate.a];
+    uint64_t b = signals[gate.b];
+    switch(gate.op)
+    {
+        case And: return a & b;
+        case Or: return a | b;
+        case Xor: return a ^ b;
+        case Nand: return ~(a & b);
+        case Nor: return ~(a | b);
+        case Xnor: return ~(a ^ b);
+        case Not: return ~a;
+        case Buf: return a;
+    }
+    return 0;
+}
+
+std::vector<bool> Circuit::Evaluate(uint32_t inputs) const
+{
+    std::vector<uint64_t> signals(m_inputCount + m_gates.size());
+    for(uint32_t i = 0; i < m_inputCount; i++)
+        signals[i] = (inputs >> i) & 1 ? ~0ull : 0;
+    for(size_t g = 0; g < m_gates.size(); g++)
+        signals[m_inputCount + g] = this->Apply(m_gates[g], signals);
+
+    std::vector<bool> outputs;
+    for(uint32_t signal : m_outputs)
+        outputs.push_back(signals[signal] & 1);
+    return outputs;
+}
+
+uint32_t Circuit::Support(uint32_t signal, std::vector<uint32_t> &cache) const
+{
+    if(signal < m_inputCount)
+        return 1u << signal;
+
+    // Gates only reference earlier signals, so one forward pass fills the cache.
+    if(cache.empty())
+    {
+        cache.resize(m_gates.size());
+        for(size_t g = 0; g < m_gates.size(); g++)
+        {
+            const Gate &gate = m_gates[g];
+            uint32_t a = gate.a < m_inputCount ? 1u << gate.a : cache[gate.a - m_inputCount];
+            uint32_t b = gate.b < m_inputCount ? 1u << gate.b : cache[gate.b - m_inputCount];
+            cache[g] = a | b;
+        }
+    }
+    return cache[signal - m_inputCount];
+}
+
+bool Circuit::SolveGroup(const std::vector<uint32_t> &outputs, uint32_t inputMask, const std::vector<bool> &want, uint32_t &inputs) const
+{
+    std::vector<uint32_t> vars;
+    for(uint32_t i = 0; i < m_inputCount; i++)
+    {
+        if(inputMask & (1u << i))
+            vars.push_back(i);
+    }
+
+    // Schedule each output's cone in turn, smallest first, so a word can be
+    // abandoned after the cheapest outputs rule out every lane.
+    std::vector<std::pair<size_t, uint32_t> > bySize;
+    std::vector<std::vector<bool> > cones;
+    for(uint32_t o : outputs)
+    {
+        std::vector<bool> cone(m_gates.size());
+        size_t size = 0;
+        if(m_outputs[o] >= m_inputCount)
+        {
+            cone[m_outputs[o] - m_inputCount] = true;
+            for(size_t g = m_gates.size(); g-- > 0; )
+            {
+                if(!cone[g])
+                    continue;
+                size++;
+                if(m_gates[g].a >= m_inputCount)
+                    cone[m_gates[g].a - m_inputCount] = true;
+                if(m_gates[g].b >= m_inputCount)
+                    cone[m_gates[g].b - m_inputCount] = true;
+            }
+        }
+        bySize.push_back(std::make_pair(size, o));
+        cones.push_back(cone);
+    }
+    std::vector<size_t> order(outputs.size());
+    for(size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return bySize[a].first < bySize[b].first; });
+
+    std::vector<uint32_t> schedule;
+    std::vector<std::pair<size_t, uint32_t> > checks;
+    std::vector<bool> scheduled(m_gates.size());
+    for(size_t i : order)
+    {
+        for(size_t g = 0; g < m_gates.size(); g++)
+        {
+            if(cones[i][g] && !scheduled[g])
+            {
+                scheduled[g] = true;
+                schedule.push_back(g);
+            }
+        }
+        checks.push_back(std::make_pair(schedule.size(), bySize[i].second));
+    }
+
+    size_t laneBits = std::min<size_t>(vars.size(), 6);
+    uint64_t laneMask = laneBits == 6 ? ~0ull : (1ull << (1u << laneBits)) - 1;
+    uint64_t words = 1ull << (vars.size() - laneBits);
+
+    std::vector<uint64_t> signals(m_inputCount + m_gates.size());
+    for(size_t b = 0; b < laneBits; b++)
+        signals[vars[b]] = LanePatterns[b];
+
+    for(uint64_t w = 0; w < words; w++)
+    {
+        for(size_t b = laneBits; b < vars.size(); b++)
+            signals[vars[b]] = (w >> (b - laneBits)) & 1 ? ~0ull : 0;
+
+        uint64_t alive = laneMask;
+        size_t next = 0;
+        for(size_t c = 0; c < checks.size() && alive; c++)
+        {
+            for(; next < checks[c].first; next++)
+            {
+                uint32_t g = schedule[next];
+                signals[m_inputCount + g] = this->Apply(m_gates[g], signals);
+            }
+            uint32_t o = checks[c].second;
+            alive &= want[o] ? signals[m_outputs[o]] : ~signals[m_outputs[o]];
+        }
+
+        if(alive)
+        {
+            uint32_t lane = __builtin_ctzll(alive);
+            for(size_t b = 0; b < vars.size(); b++)
+            {
+                bool bit = b < laneBits ? (lane >> b) & 1 : (w >> (b - laneBits)) & 1;
+                inputs = bit ? inputs | (1u << vars[b]) : inputs & ~(1u << vars[b]);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Circuit::Solve(const std::vector<bool> &want, uint32_t &inputs) const
+{
+    if(want.size() != m_outputs.size())
+        return false;
+
+    // Outputs that share an input must be searched together; everything else
+    // is independent and multiplies out of the search space.
+    std::vector<uint32_t> cache;
+    std::vector<std::pair<uint32_t, std::vector<uint32_t> > > groups;
+    for(uint32_t o = 0; o < m_outputs.size(); o++)
+    {
+        uint32_t mask = this->Support(m_outputs[o], cache);
+        std::vector<uint32_t> members(1, o);
+        for(size_t g = 0; g < groups.size(); )
+        {
+            if(groups[g].first & mask)
+            {
+                mask |= groups[g].first;
+                members.insert(members.end(), groups[g].second.begin(), groups[g].second.end());
+                groups.erase(groups.begin() + g);
+            }
+            else
+                g++;
+        }
+        groups.push_back(std::make_pair(mask, members));
+    }
+
+    inputs = 0;
+    for(auto &group : groups)
+    {
+        if(!this->SolveGroup(group.second, group.first, want, inputs))
+            return false;
+    }
+    return true;
+}
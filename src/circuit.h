@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// Gate-level model of a circuit puzzle, loaded from a netlist file:
+//
+//   inputs 8
+//   a and i0 i1
+//   b xor a i2
+//   output b
+//
+// Signals are evaluated 64 input assignments at a time, one per bit lane.
+// Solve() splits the outputs into groups that share no inputs and searches
+// each group only over the inputs it depends on, stopping a word as soon as
+// no lane can still match.
+class Circuit {
+    enum Op {And, Or, Xor, Nand, Nor, Xnor, Not, Buf};
+
+    struct Gate {
+        Op op;
+        uint32_t a;
+        uint32_t b;
+    };
+
+    uint32_t m_inputCount;
+    std::vector<Gate> m_gates;
+    std::vector<uint32_t> m_outputs;
+    std::map<std::string, uint32_t> m_signals;
+
+    uint32_t Lookup(const std::string &) const;
+    uint64_t Apply(const Gate &, const std::vector<uint64_t> &) const;
+    uint32_t Support(uint32_t signal, std::vector<uint32_t> &cache) const;
+    bool SolveGroup(const std::vector<uint32_t> &outputs, uint32_t inputMask, const std::vector<bool> &want, uint32_t &inputs) const;
+
+  public:
+    Circuit();
+    bool Load(const std::string &path);
+    size_t GetInputCount() const;
+    size_t GetOutputCount() const;
+    std::vector<bool> Evaluate(uint32_t inputs) const;
+    bool Solve(const std::vector<bool> &want, uint32_t &inputs) const;
+};
@@ -1,3 +1,5 @@
+#pragma once
+
 #include <cstdint>
 #include <string>
 #include <map>
@@ -142,6 +144,11 @@ class IQuest {
     virtual IQuestState * GetStateByName(const char *);
 };
 
+struct PlayerQuestState {
+    IQuestState *state;
+    uint32_t count;
+};
+
 class IUE4Actor {
   public:
     virtual void * GetUE4Actor();
@@ -0,0 +1,343 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include "combat.h"
+#include "events.h"
+
+CombatStats g_combat;
+
+static const uint32_t CombatMagic = 0x424d4350;
+static const uint32_t CombatVersion = 1;
+static const int32_t KillRecord = -1;
+
+static void OnDamage(const DamageEvent &event)
+{
+    g_combat.OnDamage(event.instigator, event.item, event.target, event.damage, event.type);
+}
+
+static void OnKill(const KillEvent &event)
+{
+    g_combat.OnKill((Actor*)event.killed);
+}
+
+static void OnKill(const KillSentEvent &event)
+{
+    g_combat.OnKill(event.killed);
+}
+
+SUBSCRIBE(DamageEvent, OnDamage);
+SUBSCRIBE(KillEvent, OnKill);
+SUBSCRIBE(KillSentEvent, OnKill);
+
+static double Now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint64_t HashName(const char *name)
+{
+    uint64_t h = 14695981039346656037ull;
+    for(; *name; name++)
+        h = (h ^ (unsigned char)*name) * 1099511628211ull;
+    return h;
+}
+
+CombatStats::CombatStats() : m_kills(0), m_dropped(0), m_mergeTimer(0)
+{
+    for(Ring &ring : m_rings)
+    {
+        ring.claimed = false;
+        ring.head = 0;
+        ring.tail = 0;
+        ring.dropped = 0;
+    }
+    memset(m_keys, 0, sizeof(m_keys));
+    memset(m_targets, 0, sizeof(m_targets));
+    memset(m_ttk, 0, sizeof(m_ttk));
+}
+
+CombatStats::~CombatStats()
+{
+    // This runs at exit in every process the library is preloaded into, most
+    // of which never see a hit.
+    this->Merge();
+    bool used = m_kills != 0;
+    for(const Key &key : m_keys)
+        used |= key.used;
+    if(used)
+        this->Dump("combat.bin");
+}
+
+CombatStats::Ring * CombatStats::GetRing()
+{
+    // Rings are claimed for the life of the process; the game only runs a
+    // handful of threads, and a thread past the limit just isn't recorded.
+    static thread_local Ring *ring = nullptr;
+    static thread_local bool full = false;
+    if(ring || full)
+        return ring;
+
+    for(Ring &candidate : m_rings)
+    {
+        bool expected = false;
+        if(candidate.claimed.compare_exchange_strong(expected, true))
+        {
+            ring = &candidate;
+            return ring;
+        }
+    }
+    full = true;
+    return nullptr;
+}
+
+void CombatStats::Push(const Record &record)
+{
+    Ring *ring = this->GetRing();
+    if(!ring)
+        return;
+
+    uint32_t head = ring->head.load(std::memory_order_relaxed);
+    if(head - ring->tail.load(std::memory_order_acquire) >= RingSize)
+    {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    ring->records[head % RingSize] = record;
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+void CombatStats::OnDamage(IActor *attacker, IItem *item, Actor *target, int32_t damage, DamageType type)
+{
+    Record record;
+    record.time = Now();
+    const char *name = attacker ? attacker->GetDisplayName() : nullptr;
+    strncpy(record.attacker, name ? name : "world", sizeof(record.attacker) - 1);
+    record.attacker[sizeof(record.attacker) - 1] = 0;
+    record.attackerHash = HashName(record.attacker);
+    const char *itemName = item ? item->GetName() : nullptr;
+    strncpy(record.itemName, itemName ? itemName : "-", sizeof(record.itemName) - 1);
+    record.itemName[sizeof(record.itemName) - 1] = 0;
+    record.itemHash = HashName(record.itemName);
+    record.target = target ? target->GetId() : 0;
+    record.damage = damage;
+    record.type = type;
+    this->Push(record);
+}
+
+void CombatStats::OnKill(Actor *target)
+{
+    if(!target)
+        return;
+
+    Record record = {};
+    record.time = Now();
+    record.target = target->GetId();
+    record.type = KillRecord;
+    this->Push(record);
+}
+
+CombatStats::Key * CombatStats::FindKey(const Record &record)
+{
+    size_t start = (record.attackerHash ^ record.itemHash ^ (uint32_t)record.type * 0x9e3779b9u) % Keys;
+    Key *oldest = nullptr;
+    for(size_t probe = 0; probe < Keys; probe++)
+    {
+        Key &key = m_keys[(start + probe) % Keys];
+        if(!key.used)
+        {
+            oldest = &key;
+            break;
+        }
+        if(key.attackerHash == record.attackerHash && key.itemHash == record.itemHash && key.type == record.type)
+            return &key;
+        if(!oldest || key.lastSeen < oldest->lastSeen)
+            oldest = &key;
+    }
+
+    memset(oldest, 0, sizeof(Key));
+    oldest->used = true;
+    oldest->attackerHash = record.attackerHash;
+    oldest->itemHash = record.itemHash;
+    oldest->type = record.type;
+    memcpy(oldest->attacker, record.attacker, sizeof(oldest->attacker));
+    memcpy(oldest->itemName, record.itemName, sizeof(oldest->itemName));
+    return oldest;
+}
+
+CombatStats::Target * CombatStats::FindTarget(uint32_t id, bool create, double time)
+{
+    size_t start = (id * 0x9e3779b9u) % Targets;
+    Target *oldest = nullptr;
+    for(size_t probe = 0; probe < 8; probe++)
+    {
+        Target &target = m_targets[(start + probe) % Targets];
+        if(target.used && target.id == id)
+            return &target;
+        if(!oldest || !target.used || (oldest->used && target.firstHit < oldest->firstHit))
+            oldest = &target;
+    }
+    if(!create)
+        return nullptr;
+
+    oldest->id = id;
+    oldest->used = true;
+    oldest->firstHit = time;
+    return oldest;
+}
+
+void CombatStats::Apply(const Record &record)
+{
+    if(record.type == KillRecord)
+    {
+        Target *target = this->FindTarget(record.target, false, record.time);
+        if(!target)
+            return;
+
+        size_t bucket = std::min<size_t>((record.time - target->firstHit) / TtkBucketWidth, TtkBuckets);
+        m_ttk[bucket]++;
+        m_kills++;
+        target->used = false;
+        return;
+    }
+
+    Key *key = this->FindKey(record);
+    int64_t second = (int64_t)record.time;
+    size_t slot = second % Seconds;
+    if(key->bucketSecond[slot] != second)
+    {
+        key->bucketSecond[slot] = second;
+        key->buckets[slot] = 0;
+    }
+    key->buckets[slot] += record.damage;
+    key->total += record.damage;
+    key->hits++;
+    key->lastSeen = record.time;
+
+    if(record.target)
+        this->FindTarget(record.target, true, record.time);
+}
+
+void CombatStats::Merge()
+{
+    for(Ring &ring : m_rings)
+    {
+        if(!ring.claimed.load(std::memory_order_acquire))
+            continue;
+
+        uint32_t tail = ring.tail.load(std::memory_order_relaxed);
+        uint32_t head = ring.head.load(std::memory_order_acquire);
+        for(; tail != head; tail++)
+            this->Apply(ring.records[tail % RingSize]);
+        ring.tail.store(tail, std::memory_order_release);
+        m_dropped += ring.dropped.exchange(0, std::memory_order_relaxed);
+    }
+}
+
+void CombatStats::Tick(float delta)
+{
+    m_mergeTimer += delta;
+    if(m_mergeTimer >= 1.0f)
+    {
+        m_mergeTimer = 0;
+        this->Merge();
+    }
+}
+
+float CombatStats::GetDps(const Key &key, float window, double now) const
+{
+    if(!(window > 0))
+        return 0;
+
+    // Only whole one-second buckets are summed, so divide by how many were.
+    int64_t seconds = std::min<int64_t>(std::max<int64_t>(window, 1), Seconds);
+    int64_t last = (int64_t)now;
+    int64_t first = last - seconds + 1;
+    int64_t sum = 0;
+    for(size_t i = 0; i < Seconds; i++)
+    {
+        if(key.bucketSecond[i] >= first && key.bucketSecond[i] <= last)
+            sum += key.buckets[i];
+    }
+    return (float)sum / seconds;
+}
+
+float CombatStats::GetTtkPercentile(float p) const
+{
+    if(m_kills == 0)
+        return 0;
+
+    uint32_t rank = (uint32_t)(p * (m_kills - 1));
+    uint32_t seen = 0;
+    for(size_t i = 0; i <= TtkBuckets; i++)
+    {
+        seen += m_ttk[i];
+        if(seen > rank)
+            return (i + 0.5f) * TtkBucketWidth;
+    }
+    return TtkBuckets * TtkBucketWidth;
+}
+
+void CombatStats::Print(float window)
+{
+    if(!(window > 0))
+    {
+        std::cout << "dps window must be positive" << std::endl;
+        return;
+    }
+    this->Merge();
+    double now = Now();
+
+    std::vector<std::pair<float, const Key*> > rows;
+    for(const Key &key : m_keys)
+    {
+        if(key.used)
+            rows.push_back(std::make_pair(this->GetDps(key, window, now), &key));
+    }
+    std::sort(rows.begin(), rows.end(), [](const std::pair<float, const Key*> &a, const std::pair<float, const Key*> &b) {
+        return a.first > b.first;
+    });
+
+    for(size_t i = 0; i < rows.size() && i < 10; i++)
+    {
+        const Key &key = *rows[i].second;
+        std::cout << key.attacker << ' ' << key.itemName << ' ' << key.type
+            << ' ' << rows[i].first << " dps " << key.total << " total" << std::endl;
+    }
+    std::cout << "kills " << m_kills << " ttk p50 " << this->GetTtkPercentile(0.5f) << " p90 " << this->GetTtkPercentile(0.9f)
+        << " p99 " << this->GetTtkPercentile(0.99f) << " dropped " << m_dropped << std::endl;
+}
+
+bool CombatStats::Dump(const std::string &path) const
+{
+    std::ofstream out(path, std::ios::binary);
+    if(!out)
+        return false;
+
+    uint32_t keyCount = 0;
+    for(const Key &key : m_keys)
+        keyCount += key.used;
+
+    uint32_t ttkBuckets = TtkBuckets + 1;
+    out.write((const char*)&CombatMagic, 4);
+    out.write((const char*)&CombatVersion, 4);
+    out.write((const char*)&m_kills, 4);
+    out.write((const char*)&m_dropped, 4);
+    out.write((const char*)&keyCount, 4);
+    for(const Key &key : m_keys)
+    {
+        if(!key.used)
+            continue;
+
+        out.write(key.attacker, sizeof(key.attacker));
+        out.write(key.itemName, sizeof(key.itemName));
+        out.write((const char*)&key.type, 4);
+        out.write((const char*)&key.total, 8);
+        out.write((const char*)&key.hits, 4);
+    }
+    out.write((const char*)&ttkBuckets, 4);
+    out.write((const char*)m_ttk, sizeof(m_ttk));
+    return out.good();
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include "classes.h"
+
+// Streaming damage and kill statistics. Hooks on any thread append to that
+// thread's own single-producer ring; the tick thread drains every ring once a
+// second into fixed-size tables, so memory does not grow with session length.
+// Attacker and item names are copied when the hit happens and targets are
+// keyed by actor id, so the tables never hold pointers to game objects that
+// may since have been destroyed.
+class CombatStats {
+  public:
+    static constexpr size_t Threads = 8;
+    static constexpr size_t RingSize = 2048;
+    static constexpr size_t Keys = 256;
+    static constexpr size_t Targets = 512;
+    static constexpr size_t Seconds = 60;
+    static constexpr size_t TtkBuckets = 600;
+    static constexpr float TtkBucketWidth = 0.1f;
+
+    struct Record {
+        double time;
+        uint64_t attackerHash;
+        uint64_t itemHash;
+        char attacker[32];
+        char itemName[32];
+        uint32_t target;
+        int32_t damage;
+        int32_t type;
+    };
+
+    struct Ring {
+        std::atomic<bool> claimed;
+        std::atomic<uint32_t> head;
+        std::atomic<uint32_t> tail;
+        std::atomic<uint32_t> dropped;
+        Record records[RingSize];
+    };
+
+    struct Key {
+        uint64_t attackerHash;
+        uint64_t itemHash;
+        int32_t type;
+        bool used;
+        char attacker[32];
+        char itemName[32];
+        int64_t total;
+        uint32_t hits;
+        double lastSeen;
+        int64_t buckets[Seconds];
+        int64_t bucketSecond[Seconds];
+    };
+
+    struct Target {
+        uint32_t id;
+        bool used;
+        double firstHit;
+    };
+
+  private:
+    Ring m_rings[Threads];
+    Key m_keys[Keys];
+    Target m_targets[Targets];
+    uint32_t m_ttk[TtkBuckets + 1];
+    uint32_t m_kills;
+    uint32_t m_dropped;
+    float m_mergeTimer;
+
+    Ring * GetRing();
+    void Push(const Record &);
+    void Apply(const Record &);
+    Key * FindKey(const Record &);
+    Target * FindTarget(uint32_t id, bool create, double);
+
+  public:
+    CombatStats();
+    ~CombatStats();
+    void OnDamage(IActor *attacker, IItem *item, Actor *target, int32_t damage, DamageType type);
+    void OnKill(Actor *target);
+    void Tick(float delta);
+    void Merge();
+    float GetDps(const Key &, float window, double now) const;
+    float GetTtkPercentile(float p) const;
+    void Print(float window);
+    bool Dump(const std::string &path) const;
+};
+
+extern CombatStats g_combat;
@@ -0,0 +1,40 @@
+#include <chrono>
+#include <iostream>
+#include "events.h"
+
+struct BenchmarkEvent {
+    uint32_t value;
+};
+
+static uint64_t s_benchmarkSum;
+
+static void OnBenchmarkEvent(const BenchmarkEvent &event)
+{
+    s_benchmarkSum += event.value;
+}
+
+void BenchmarkEvents(size_t iterations)
+{
+    BenchmarkEvent event = {1};
+
+    auto start = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < iterations; i++)
+    {
+        Publish(event);
+        asm volatile("" ::: "memory");
+    }
+    auto middle = std::chrono::steady_clock::now();
+
+    if(EventChannel<BenchmarkEvent>::GetCount() == 0)
+        EventChannel<BenchmarkEvent>::Subscribe(OnBenchmarkEvent);
+    for(size_t i = 0; i < iterations; i++)
+    {
+        Publish(event);
+        asm volatile("" ::: "memory");
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double idleNs = std::chrono::duration<double, std::nano>(middle - start).count() / iterations;
+    double busyNs = std::chrono::duration<double, std::nano>(end - middle).count() / iterations;
+    std::cout << "no subscribers " << idleNs << " ns/event, one subscriber " << busyNs << " ns/event" << std::endl;
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "classes.h"
+
+struct DamageEvent {
+    Actor *target;
+    IActor *instigator;
+    IItem *item;
+    int32_t damage;
+    DamageType type;
+};
+
+struct KillEvent {
+    Player *player;
+    IPlayer *killer;
+    IActor *killed;
+    IItem *item;
+};
+
+struct LocalDeathEvent {
+    Player *player;
+    IPlayer *killer;
+    IItem *item;
+};
+
+struct ChatEvent {
+    Player *player;
+    Player *from;
+    const std::string *text;
+};
+
+struct ItemAddedEvent {
+    Player *player;
+    IItem *item;
+    uint32_t count;
+};
+
+struct ItemRemovedEvent {
+    Player *player;
+    IItem *item;
+    uint32_t count;
+};
+
+struct ShopOpenedEvent {
+    Player *player;
+    Actor *npc;
+};
+
+struct QuestStartedEvent {
+    Player *player;
+    IQuest *quest;
+};
+
+struct QuestAdvancedEvent {
+    Player *player;
+    IQuest *quest;
+    IQuestState *state;
+};
+
+struct QuestCompletedEvent {
+    Player *player;
+    IQuest *quest;
+};
+
+struct KillSentEvent {
+    Player *player;
+    Actor *killed;
+    IItem *item;
+};
+
+struct HealthSentEvent {
+    Actor *actor;
+    int32_t health;
+};
+
+struct RegionChangedEvent {
+    Player *player;
+    const std::string *region;
+};
+
+struct TravelCompletedEvent {
+    Player *player;
+    const std::string *destination;
+};
+
+// One channel per event type, instantiated from the template. Handlers are
+// plain function pointers in a fixed array, so publishing allocates nothing
+// and an event nobody listens to costs a load and a compare.
+template<typename Event, size_t Capacity = 16>
+class EventChannel {
+  public:
+    typedef void (*Handler)(const Event &);
+
+  private:
+    static inline Handler s_handlers[Capacity] = {};
+    static inline size_t s_count = 0;
+
+  public:
+    static bool Subscribe(Handler handler)
+    {
+        if(s_count == Capacity)
+            return false;
+        s_handlers[s_count++] = handler;
+        return true;
+    }
+
+    static size_t GetCount()
+    {
+        return s_count;
+    }
+
+    static inline void Publish(const Event &event)
+    {
+        for(size_t i = 0; i < s_count; i++)
+            s_handlers[i](event);
+    }
+};
+
+template<typename Event>
+inline void Publish(const Event &event)
+{
+    EventChannel<Event>::Publish(event);
+}
+
+template<typename Event, void (*Handler)(const Event &)>
+struct EventSubscription {
+    EventSubscription()
+    {
+        EventChannel<Event>::Subscribe(Handler);
+    }
+};
+
+// Registers a handler during static initialization, before the game calls
+// into any hook:  SUBSCRIBE(ItemAddedEvent, OnItemAdded);
+#define SUBSCRIBE_NAME2(a, b) a##b
+#define SUBSCRIBE_NAME(a, b) SUBSCRIBE_NAME2(a, b)
+#define SUBSCRIBE(Event, Handler) \
+    static EventSubscription<Event, Handler> SUBSCRIBE_NAME(s_subscription, __LINE__)
+
+void BenchmarkEvents(size_t iterations);
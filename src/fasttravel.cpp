@@ -0,0 +1,194 @@
+#include <deque>
+#include <iostream>
+#include <strings.h>
+#include "events.h"
+#include "fasttravel.h"
+
+FastTravelGraph g_fastTravel;
+
+static void OnRegionChanged(const RegionChangedEvent &event)
+{
+    if(event.player->IsLocalPlayer())
+        g_fastTravel.OnRegionChange(*event.region);
+}
+
+static void OnTravelCompleted(const TravelCompletedEvent &event)
+{
+    if(event.player->IsLocalPlayer())
+        g_fastTravel.OnArrival(*event.destination, event.player->GetPosition());
+}
+
+SUBSCRIBE(RegionChangedEvent, OnRegionChanged);
+SUBSCRIBE(TravelCompletedEvent, OnTravelCompleted);
+
+FastTravelGraph::FastTravelGraph() : m_size(0), m_current(None), m_arrivals(0), m_dirty(true)
+{
+}
+
+uint32_t FastTravelGraph::Intern(const std::string &name)
+{
+    auto found = m_index.find(name);
+    if(found != m_index.end())
+        return found->second;
+
+    Destination destination = {name, name, Vector3(0, 0, 0), false};
+    m_destinations.push_back(destination);
+    m_edges.resize(m_destinations.size());
+    m_index[name] = m_destinations.size() - 1;
+    return m_destinations.size() - 1;
+}
+
+uint32_t FastTravelGraph::Find(const std::string &name) const
+{
+    auto found = m_index.find(name);
+    if(found != m_index.end())
+        return found->second;
+
+    for(size_t i = 0; i < m_destinations.size(); i++)
+    {
+        if(!strcasecmp(m_destinations[i].name.c_str(), name.c_str()) || !strcasecmp(m_destinations[i].displayName.c_str(), name.c_str()))
+            return i;
+    }
+    return None;
+}
+
+void FastTravelGraph::OnRegionChange(const std::string &region)
+{
+    // Trips start from wherever the player now is, not the last station.
+    m_current = this->Intern(region);
+    m_dirty = true;
+}
+
+void FastTravelGraph::EnsureBuilt(Player *player)
+{
+    if(m_dirty)
+        this->Build(player);
+}
+
+void FastTravelGraph::Build(Player *player)
+{
+    for(auto &edges : m_edges)
+        edges.clear();
+
+    // Start from the player's station, then anything learned earlier, so
+    // stations only reachable before a region change keep their edges.
+    std::deque<uint32_t> queue;
+    std::vector<bool> expanded(m_destinations.size(), false);
+    uint32_t start = this->GetCurrent(player);
+    if(start != None)
+        queue.push_back(start);
+    for(uint32_t i = 0; i < m_destinations.size(); i++)
+        queue.push_back(i);
+
+    while(!queue.empty())
+    {
+        uint32_t from = queue.front();
+        queue.pop_front();
+        expanded.resize(m_destinations.size(), false);
+        if(expanded[from])
+            continue;
+        expanded[from] = true;
+
+        IFastTravel *list = player->GetFastTravelDestinations(m_destinations[from].name.c_str());
+        if(!list)
+            continue;
+
+        for(size_t i = 0; i < list->GetCount(); i++)
+        {
+            uint32_t to = this->Intern(list->GetRegionName(i));
+            m_destinations[to].displayName = list->GetDisplayName(i);
+            if(to != from)
+                m_edges[from].push_back(to);
+            queue.push_back(to);
+        }
+        list->Destroy();
+    }
+
+    // First hop from every station to every other, one BFS per source.
+    m_size = m_destinations.size();
+    m_next.assign(m_size * m_size, None);
+    for(uint32_t source = 0; source < m_size; source++)
+    {
+        uint32_t *next = &m_next[source * m_size];
+        std::deque<uint32_t> frontier(1, source);
+        next[source] = source;
+        while(!frontier.empty())
+        {
+            uint32_t u = frontier.front();
+            frontier.pop_front();
+            for(uint32_t v : m_edges[u])
+            {
+                if(next[v] != None)
+                    continue;
+                next[v] = u == source ? v : next[u];
+                frontier.push_back(v);
+            }
+        }
+    }
+    m_dirty = false;
+}
+
+void FastTravelGraph::OnArrival(const std::string &name, const struct Vector3 &pos)
+{
+    uint32_t id = this->Intern(name);
+    m_destinations[id].pos = pos;
+    m_destinations[id].visited = true;
+    m_current = id;
+    m_arrivals++;
+}
+
+bool FastTravelGraph::Route(uint32_t from, uint32_t to, std::vector<uint32_t> &hops) const
+{
+    hops.clear();
+    if(from >= m_size || to >= m_size)
+        return false;
+
+    for(uint32_t at = from; at != to; )
+    {
+        at = m_next[at * m_size + to];
+        if(at == None)
+            return false;
+        hops.push_back(at);
+    }
+    return true;
+}
+
+uint32_t FastTravelGraph::GetCurrent(Player *player)
+{
+    if(m_current != None || player->m_currentRegion.empty())
+        return m_current;
+    return this->Intern(player->m_currentRegion);
+}
+
+uint32_t FastTravelGraph::GetArrivals() const
+{
+    return m_arrivals;
+}
+
+const std::string & FastTravelGraph::GetName(uint32_t id) const
+{
+    return m_destinations[id].name;
+}
+
+void FastTravelGraph::Print(Player *player)
+{
+    this->EnsureBuilt(player);
+    uint32_t current = this->GetCurrent(player);
+
+    std::vector<uint32_t> hops;
+    for(uint32_t i = 0; i < m_destinations.size(); i++)
+    {
+        const Destination &destination = m_destinations[i];
+        std::cout << (i == current ? "* " : "  ") << destination.name << " (" << destination.displayName << ")";
+        if(current != None && i != current)
+        {
+            if(this->Route(current, i, hops))
+                std::cout << ' ' << hops.size() << " hops";
+            else
+                std::cout << " unreachable";
+        }
+        if(destination.visited)
+            std::cout << " at " << destination.pos.x << ' ' << destination.pos.y << ' ' << destination.pos.z;
+        std::cout << std::endl;
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "classes.h"
+
+// The fast-travel network as the game reports it. Each station's
+// GetFastTravelDestinations result is walked once, breadth first from the
+// player's region, and turned into an edge list over interned names; an
+// all-pairs next-hop table then makes routing a lookup. The graph is only
+// rebuilt after a region change, which also moves the player's current
+// station. Names and arrival positions are kept across rebuilds.
+class FastTravelGraph {
+    struct Destination {
+        std::string name;
+        std::string displayName;
+        struct Vector3 pos;
+        bool visited;
+    };
+
+    std::vector<Destination> m_destinations;
+    std::unordered_map<std::string, uint32_t> m_index;
+    std::vector<std::vector<uint32_t> > m_edges;
+    std::vector<uint32_t> m_next;
+    size_t m_size;
+    uint32_t m_current;
+    uint32_t m_arrivals;
+    bool m_dirty;
+
+    void Build(Player *);
+
+  public:
+    static constexpr uint32_t None = 0xffffffff;
+
+    FastTravelGraph();
+    uint32_t Intern(const std::string &);
+    uint32_t Find(const std::string &) const;
+    void OnRegionChange(const std::string &);
+    void EnsureBuilt(Player *);
+    void OnArrival(const std::string &, const struct Vector3 &);
+    bool Route(uint32_t from, uint32_t to, std::vector<uint32_t> &hops) const;
+    uint32_t GetCurrent(Player *);
+    uint32_t GetArrivals() const;
+    const std::string & GetName(uint32_t) const;
+    void Print(Player *);
+};
+
+extern FastTravelGraph g_fastTravel;
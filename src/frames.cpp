@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include "frames.h"
+
+FrameMonitor g_frames;
+
+FrameMonitor::FrameMonitor()
+    : m_frame(0), m_hitchCount(0), m_lastNetTimer(1e9f), m_hitchMs(50), m_hitchFactor(3), m_median(0)
+{
+    memset(m_frames, 0, sizeof(m_frames));
+    memset(m_histogram, 0, sizeof(m_histogram));
+    memset(m_hitches, 0, sizeof(m_hitches));
+    for(HookTotal &hook : m_hooks)
+    {
+        hook.name = nullptr;
+        hook.ns = 0;
+        hook.calls = 0;
+    }
+}
+
+size_t FrameMonitor::BucketOf(float ms)
+{
+    if(!(ms >= 0))
+        return 0;
+    return std::min<size_t>(ms / BucketWidth, Buckets);
+}
+
+void FrameMonitor::AddHookTime(const char *name, uint64_t ns)
+{
+    // Scope names are string literals, so the pointer is the key.
+    size_t start = ((uintptr_t)name >> 3) % Hooks;
+    for(size_t probe = 0; probe < Hooks; probe++)
+    {
+        HookTotal &hook = m_hooks[(start + probe) % Hooks];
+        const char *current = hook.name.load(std::memory_order_acquire);
+        if(!current && hook.name.compare_exchange_strong(current, name, std::memory_order_acq_rel))
+            current = name;
+        if(current == name)
+        {
+            hook.ns.fetch_add(ns, std::memory_order_relaxed);
+            hook.calls.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+}
+
+void FrameMonitor::Tick(ClientWorld *world, float delta)
+{
+    Frame frame = {delta * 1000.0f, 0, 0, false};
+
+    // The net timer counts down by the frame time and jumps back up when a
+    // net tick goes out.
+    if(world)
+    {
+        frame.netTick = world->m_timeUntilNextNetTick > m_lastNetTimer;
+        m_lastNetTimer = world->m_timeUntilNextNetTick;
+    }
+
+    HookShare shares[Hooks];
+    size_t count = 0;
+    for(HookTotal &hook : m_hooks)
+    {
+        const char *name = hook.name.load(std::memory_order_acquire);
+        if(!name)
+            continue;
+
+        uint64_t ns = hook.ns.exchange(0, std::memory_order_relaxed);
+        uint32_t calls = hook.calls.exchange(0, std::memory_order_relaxed);
+        if(calls == 0)
+            continue;
+
+        shares[count++] = {name, ns / 1e6f, calls};
+        frame.hookMs += ns / 1e6f;
+        frame.hookCalls += calls;
+    }
+
+    Frame &slot = m_frames[m_frame % Frames];
+    if(m_frame >= Frames)
+        m_histogram[BucketOf(slot.ms)]--;
+    slot = frame;
+    m_histogram[BucketOf(frame.ms)]++;
+
+    if(m_frame % 64 == 0)
+        m_median = this->GetPercentile(0.5f);
+    this->CheckHitch(frame, shares, count);
+    m_frame++;
+}
+
+void FrameMonitor::CheckHitch(const Frame &frame, HookShare *shares, size_t count)
+{
+    bool absolute = m_hitchMs > 0 && frame.ms > m_hitchMs;
+    bool relative = m_hitchFactor > 0 && m_median > 0 && m_frame >= 64 && frame.ms > m_hitchFactor * m_median;
+    if(!absolute && !relative)
+        return;
+
+    size_t top = std::min(count, TopHooks);
+    std::partial_sort(shares, shares + top, shares + count, [](const HookShare &a, const HookShare &b) {
+        return a.ms > b.ms;
+    });
+
+    Hitch &hitch = m_hitches[m_hitchCount++ % Hitches];
+    memset(&hitch, 0, sizeof(hitch));
+    hitch.frame = m_frame;
+    hitch.ms = frame.ms;
+    hitch.hookMs = frame.hookMs;
+    hitch.netTick = frame.netTick;
+    std::copy(shares, shares + top, hitch.top);
+
+    std::cout << "hitch " << hitch.frame << ' ' << hitch.ms << " ms, "
+        << (hitch.hookMs * 2 > hitch.ms ? "hooks " : "engine, hooks ") << hitch.hookMs << " ms"
+        << (hitch.netTick ? ", net tick" : "");
+    for(size_t i = 0; i < top; i++)
+        std::cout << ", " << hitch.top[i].name << ' ' << hitch.top[i].ms << " ms x" << hitch.top[i].calls;
+    std::cout << std::endl;
+}
+
+void FrameMonitor::SetHitchThresholds(float ms, float factor)
+{
+    m_hitchMs = ms;
+    m_hitchFactor = factor;
+}
+
+float FrameMonitor::GetPercentile(float p) const
+{
+    size_t count = std::min<uint64_t>(m_frame, Frames);
+    if(count == 0)
+        return 0;
+
+    size_t rank = (size_t)(p * (count - 1));
+    size_t seen = 0;
+    for(size_t i = 0; i <= Buckets; i++)
+    {
+        seen += m_histogram[i];
+        if(seen > rank)
+            return (i + 0.5f) * BucketWidth;
+    }
+    return Buckets * BucketWidth;
+}
+
+// The histogram stops at Buckets * BucketWidth, so the longest frame comes
+// from the ring itself.
+float FrameMonitor::GetMax() const
+{
+    size_t count = std::min<uint64_t>(m_frame, Frames);
+    float max = 0;
+    for(size_t i = 0; i < count; i++)
+        max = std::max(max, m_frames[i].ms);
+    return max;
+}
+
+void FrameMonitor::Print() const
+{
+    std::cout << "frames " << m_frame << " p50 " << this->GetPercentile(0.5f) << " p90 " << this->GetPercentile(0.9f)
+        << " p99 " << this->GetPercentile(0.99f) << " max " << this->GetMax() << " ms, hitches " << m_hitchCount
+        << " (over " << m_hitchMs << " ms or " << m_hitchFactor << "x p50)" << std::endl;
+
+    uint64_t first = m_hitchCount > 8 ? m_hitchCount - 8 : 0;
+    for(uint64_t i = first; i < m_hitchCount; i++)
+    {
+        const Hitch &hitch = m_hitches[i % Hitches];
+        std::cout << "  " << hitch.frame << ' ' << hitch.ms << " ms, hooks " << hitch.hookMs << " ms"
+            << (hitch.netTick ? ", net tick" : "") << (hitch.top[0].name ? ", " : "")
+            << (hitch.top[0].name ? hitch.top[0].name : "") << std::endl;
+    }
+}
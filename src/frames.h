@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include "classes.h"
+
+// Frame pacing monitor. Every World::Tick delta goes into a ring covering the
+// last minute or so, with a histogram updated as frames enter and leave the
+// ring, so percentiles never need a sort. ProfileScope reports hook self-time
+// here from any thread; each frame takes the accumulated totals, and a frame
+// over the hitch thresholds is logged with the hooks and net tick behind it.
+class FrameMonitor {
+  public:
+    static constexpr size_t Frames = 4096;
+    static constexpr size_t Buckets = 1000;
+    static constexpr float BucketWidth = 0.25f;
+    static constexpr size_t Hooks = 32;
+    static constexpr size_t Hitches = 64;
+    static constexpr size_t TopHooks = 3;
+
+    struct Frame {
+        float ms;
+        float hookMs;
+        uint32_t hookCalls;
+        bool netTick;
+    };
+
+    struct HookTotal {
+        std::atomic<const char*> name;
+        std::atomic<uint64_t> ns;
+        std::atomic<uint32_t> calls;
+    };
+
+    struct HookShare {
+        const char *name;
+        float ms;
+        uint32_t calls;
+    };
+
+    struct Hitch {
+        uint64_t frame;
+        float ms;
+        float hookMs;
+        bool netTick;
+        HookShare top[TopHooks];
+    };
+
+  private:
+    Frame m_frames[Frames];
+    uint16_t m_histogram[Buckets + 1];
+    HookTotal m_hooks[Hooks];
+    Hitch m_hitches[Hitches];
+    uint64_t m_frame;
+    uint64_t m_hitchCount;
+    float m_lastNetTimer;
+    float m_hitchMs;
+    float m_hitchFactor;
+    float m_median;
+
+    static size_t BucketOf(float ms);
+    void CheckHitch(const Frame &, HookShare *shares, size_t count);
+
+  public:
+    FrameMonitor();
+    void AddHookTime(const char *name, uint64_t ns);
+    void Tick(ClientWorld *, float delta);
+    void SetHitchThresholds(float ms, float factor);
+    float GetPercentile(float p) const;
+    float GetMax() const;
+    void Print() const;
+};
+
+extern FrameMonitor g_frames;
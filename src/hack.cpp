@@ -1,10 +1,73 @@
+#include <chrono>
+#include <fstream>
 #include <iostream>
 #include <sstream>
 #include <dlfcn.h>
 #include "classes.h"
+#include "visibility.h"
+#include "predict.h"
+#include "nav.h"
+#include "circuit.h"
+#include "shopcache.h"
+#include "handles.h"
+#include "events.h"
+#include "script.h"
+#include "quests.h"
+#include "combat.h"
+#include "alloc.h"
+#include "frames.h"
+#include "snapshot.h"
+#include "fasttravel.h"
+
+template<typename T>
+T Original(const char *symbol)
+{
+    return (T)dlsym(RTLD_NEXT, symbol);
+}
+
+static Script TeleportAndBack(Player *player, Vector3 target, float seconds)
+{
+    Vector3 home = player->GetPosition();
+    player->SetPosition(target);
+    co_await Delay(seconds);
+    player->SetPosition(home);
+}
+
+static Script Strike(Player *player, Vector3 target, size_t slot)
+{
+    Vector3 home = player->GetPosition();
+    size_t previousSlot = player->GetCurrentSlot();
+    player->SetPosition(target);
+    co_await Delay(0.5f);
+    player->SetCurrentSlot(slot);
+    co_await NextTick();
+    player->SetFireRequestState(true);
+    co_await Delay(0.2f);
+    player->SetFireRequestState(false);
+    player->SetPosition(home);
+    player->SetCurrentSlot(previousSlot);
+}
+
+static Script FastTravelRoute(Player *player, std::string origin, std::vector<std::string> hops)
+{
+    for(const std::string &hop : hops)
+    {
+        uint32_t arrivals = g_fastTravel.GetArrivals();
+        float deadline = g_scripts.GetTime() + 15.0f;
+        player->FastTravel(origin.c_str(), hop.c_str());
+        co_await Until([&] { return g_fastTravel.GetArrivals() != arrivals || g_scripts.GetTime() > deadline; });
+        if(g_fastTravel.GetArrivals() == arrivals)
+        {
+            std::cout << "fast travel to " << hop << " timed out" << std::endl;
+            co_return;
+        }
+        origin = hop;
+    }
+}
 
 void Player::Chat(const char *msg)
 {
+    ProfileScope scope("Player::Chat");
     std::stringstream ss(msg);
     std::string cmd;
 
@@ -23,21 +86,418 @@ void Player::Chat(const char *msg)
         {
             this->SetPosition(newPos);
         }
+        if(cmd[2] == 'b')
+        {
+            float seconds = 1;
+            ss >> seconds;
+            g_scripts.Start(TeleportAndBack(this, newPos, seconds));
+        }
+    }
+    if(cmd == "strike")
+    {
+        float x, y, z;
+        size_t slot = 0;
+        ss >> x >> y >> z >> slot;
+        g_scripts.Start(Strike(this, Vector3(x, y, z), slot));
+    }
+    if(cmd == "los")
+    {
+        uint32_t id;
+        ss >> id;
+
+        Actor *target = g_actorTable.Find(id);
+        if(target)
+        {
+            Visibility v = g_visibility.Query(this, target);
+            std::cout << id << (v.known ? (v.visible ? " visible " : " hidden ") : " unknown ") << v.age << std::endl;
+        }
+    }
+    if(cmd == "threats")
+    {
+        float radius = 5000;
+        ss >> radius;
+
+        ClientWorld* world = *((ClientWorld**)(dlsym(RTLD_NEXT, "GameWorld")));
+        Vector3 pos = this->GetPosition();
+        TrajectoryPredictor predictor(60, 1.0f / 30, 0);
+        predictor.Load(world->GetProjectilesInRadius(pos, radius));
+        for(ProjectileThreat &t : predictor.Predict(world->GetPlayersInRadius(pos, radius)))
+        {
+            std::cout << t.player->GetPlayerName() << ' ' << t.time << ' ' << t.position.x << ' ' << t.position.y << ' ' << t.position.z << std::endl;
+        }
+    }
+    if(cmd == "nav")
+    {
+        float x, y, z;
+        ss >> x >> y >> z;
+
+        std::vector<Vector3> hops;
+        if(g_nav.Route(this->GetPosition(), Vector3(x, y, z), hops))
+            g_navTraveler.Start(this, hops);
+        std::cout << hops.size() << " hops" << std::endl;
+    }
+    if(cmd == "ft")
+    {
+        std::string name;
+        std::getline(ss >> std::ws, name);
+
+        if(name.empty())
+            g_fastTravel.Print(this);
+        else
+        {
+            g_fastTravel.EnsureBuilt(this);
+            uint32_t from = g_fastTravel.GetCurrent(this);
+            uint32_t to = g_fastTravel.Find(name);
+
+            std::vector<uint32_t> hops;
+            if(from == FastTravelGraph::None || to == FastTravelGraph::None || !g_fastTravel.Route(from, to, hops))
+                std::cout << "no route to " << name << std::endl;
+            else
+            {
+                std::vector<std::string> names;
+                for(uint32_t hop : hops)
+                    names.push_back(g_fastTravel.GetName(hop));
+                g_scripts.Start(FastTravelRoute(this, g_fastTravel.GetName(from), names));
+                std::cout << hops.size() << " hops" << std::endl;
+            }
+        }
+    }
+    if(cmd == "navsave" || cmd == "navload")
+    {
+        std::string path = "nav.bin";
+        ss >> path;
+
+        bool ok = cmd == "navsave" ? g_nav.Save(path) : g_nav.Load(path);
+        std::cout << path << (ok ? " ok " : " failed ") << g_nav.GetNodeCount() << " nodes" << std::endl;
+    }
+    if(cmd == "solve")
+    {
+        std::string name, path, bits;
+        ss >> name >> path >> bits;
+
+        Circuit circuit;
+        std::vector<bool> want;
+        for(char c : bits)
+            want.push_back(c == '1');
+
+        uint32_t inputs;
+        if(circuit.Load(path) && circuit.Solve(want, inputs))
+        {
+            std::cout << name << " inputs " << std::hex << inputs << std::dec << std::endl;
+            this->SetCircuitInputs(name.c_str(), inputs);
+        }
+        else
+            std::cout << name << " no solution" << std::endl;
+    }
+    if(cmd == "shop")
+    {
+        std::string order = "value";
+        ss >> order;
+
+        NPC *npc = this->GetCurrentNPC();
+        if(npc)
+        {
+            ShopOrder by = order == "price" ? ShopByBuyPrice : order == "rarity" ? ShopByRarity : order == "dps" ? ShopByDamagePerSecond : ShopByDamagePerCoin;
+            for(const ShopEntry &e : ShopCache::Sorted(g_shopCache.Get(npc), by))
+            {
+                std::cout << e.name << ' ' << e.buyPrice << ' ' << e.damagePerSecond << ' ' << e.manaCost << std::endl;
+            }
+        }
+    }
+    if(cmd == "quests")
+    {
+        uint64_t since = 0;
+        ss >> since;
+
+        std::vector<QuestChangeRecord> changes;
+        if(g_quests.GetChangesSince(since, changes))
+        {
+            for(const QuestChangeRecord &c : changes)
+            {
+                const QuestEntry &q = g_quests.GetQuests()[c.index];
+                std::cout << c.sequence << " tick " << c.tick << ' ' << q.quest->GetName() << ' ' << c.change << ' ' << (c.state ? c.state->GetName() : "-") << std::endl;
+            }
+        }
+        else
+        {
+            for(const QuestEntry &q : g_quests.GetQuests())
+            {
+                std::cout << q.changedAt << ' ' << q.quest->GetName() << ' ' << (q.completed ? "done" : (q.state ? q.state->GetName() : "-")) << std::endl;
+            }
+        }
+        std::cout << "now " << g_quests.GetCursor() << std::endl;
+    }
+    if(cmd == "dps")
+    {
+        float window = 10;
+        ss >> window;
+        g_combat.Print(window);
+    }
+    if(cmd == "frames")
+    {
+        std::string what;
+        ss >> what;
+
+        if(what == "hitch")
+        {
+            float ms = 0, factor = 0;
+            ss >> ms >> factor;
+            g_frames.SetHitchThresholds(ms, factor);
+        }
+        g_frames.Print();
+    }
+    if(cmd == "snap")
+    {
+        static const PlayerSnapshot *last = nullptr;
+        std::string what, name, other;
+        ss >> what >> name >> other;
+
+        auto found = g_snapshots.find(name);
+        if(what == "save")
+        {
+            auto start = std::chrono::steady_clock::now();
+            PlayerSnapshot snapshot = PlayerSnapshot::Capture(this, last);
+            double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+            last = &(g_snapshots[name] = snapshot);
+            std::cout << name << ' ' << snapshot.GetSize() << " bytes in " << us << " us" << std::endl;
+        }
+        if(what == "load" && found != g_snapshots.end())
+            std::cout << found->second.Restore(this) << " differences could not be restored" << std::endl;
+        if(what == "diff" && found != g_snapshots.end() && g_snapshots.count(other))
+        {
+            const char *sections[] = {"items", "quests", "pickups", "status"};
+            uint32_t changed = found->second.Diff(g_snapshots[other]);
+            for(size_t i = 0; i < SnapshotSections; i++)
+            {
+                const char *state = (changed & (1 << i)) ? "changed" : (found->second.Shares(g_snapshots[other], (SnapshotSection)i) ? "shared" : "same");
+                std::cout << sections[i] << ' ' << state << std::endl;
+            }
+        }
+        if(what == "write" && found != g_snapshots.end())
+        {
+            std::vector<uint8_t> blob = found->second.Serialize();
+            std::ofstream out(other.empty() ? name + ".snap" : other, std::ios::binary);
+            out.write((const char*)blob.data(), blob.size());
+        }
+        if(what == "read")
+        {
+            std::ifstream in(other.empty() ? name + ".snap" : other, std::ios::binary);
+            std::vector<uint8_t> blob((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+            PlayerSnapshot snapshot;
+            if(snapshot.Deserialize(blob))
+                g_snapshots[name] = snapshot;
+            else
+                std::cout << "not a snapshot" << std::endl;
+        }
+        if(what == "list")
+        {
+            for(auto &entry : g_snapshots)
+                std::cout << entry.first << ' ' << entry.second.GetSize() << " bytes" << std::endl;
+        }
+    }
+    if(cmd == "alloc")
+    {
+        if(AllocProfiler::IsEnabled())
+            AllocProfiler::Dump("alloc.folded");
+        else
+            std::cout << "set HACK_ALLOC_PROFILE=1 before launching" << std::endl;
+    }
+    if(cmd == "bench")
+    {
+        std::string what;
+        ss >> what;
+
+        if(what == "handles")
+            BenchmarkActorTable(2000, 1000000);
+        if(what == "events")
+            BenchmarkEvents(10000000);
     }
 }
 
 void World::Tick(float delta)
 {
+    ProfileScope scope("World::Tick");
     ClientWorld* world = *((ClientWorld**)(dlsym(RTLD_NEXT, "GameWorld")));
+    g_frames.Tick(world, delta);
+    if(g_actorTable.GetCount() == 0)
+    {
+        for(auto &entry : world->m_actorsById)
+            g_actorTable.Insert(entry.first, (Actor*)entry.second.Get());
+    }
+    g_visibility.Tick(delta);
+    g_navTraveler.Tick();
+    g_scripts.Tick(delta);
+    g_quests.Tick();
+    g_combat.Tick(delta);
+    AllocProfiler::Tick(delta);
+    if(!g_quests.IsSeeded() && world->m_activePlayer)
+        g_quests.Seed((Player*)world->m_activePlayer.Get());
     for(ActorRef<IPlayer> p : world->m_players)
     {
         Player *player = (Player*)p.Get();
         Vector3 v = player->GetPosition();
+        g_nav.Record(player->GetId(), v);
         std::cout << v.x << ' ' << v.y << ' ' << v.z << std::endl;
         //player->SetPosition(Vector3(0, 0, 0));
     }
 }
 
+// GameWorld is a ClientWorld, which overrides the World send functions, so
+// those are hooked on ClientWorld.
+void ClientWorld::SendNPCShopEvent(Player *player, Actor *npc)
+{
+    static auto original = Original<void (*)(ClientWorld *, Player *, Actor *)>("_ZN11ClientWorld16SendNPCShopEventEP6PlayerP5Actor");
+    original(this, player, npc);
+    ProfileScope scope("ClientWorld::SendNPCShopEvent");
+    Publish(ShopOpenedEvent{player, npc});
+}
+
+void World::AddActorToWorldWithId(uint32_t id, Actor *actor)
+{
+    static auto original = Original<void (*)(World *, uint32_t, Actor *)>("_ZN5World21AddActorToWorldWithIdEjP5Actor");
+    original(this, id, actor);
+    ProfileScope scope("World::AddActorToWorldWithId");
+    g_actorTable.Insert(id, actor);
+}
+
+void World::DestroyActor(Actor *actor)
+{
+    static auto original = Original<void (*)(World *, Actor *)>("_ZN5World12DestroyActorEP5Actor");
+    {
+        ProfileScope scope("World::DestroyActor");
+        g_actorTable.Remove(actor->GetId());
+    }
+    original(this, actor);
+}
+
+void World::ChangeActorId(Player *player, uint32_t id)
+{
+    static auto original = Original<void (*)(World *, Player *, uint32_t)>("_ZN5World13ChangeActorIdEP6Playerj");
+    uint32_t oldId = player->GetId();
+    original(this, player, id);
+    ProfileScope scope("World::ChangeActorId");
+    g_actorTable.ChangeId(oldId, id);
+}
+
+void ClientWorld::SendKillEvent(Player *player, Actor *killed, IItem *item)
+{
+    static auto original = Original<void (*)(ClientWorld *, Player *, Actor *, IItem *)>("_ZN11ClientWorld13SendKillEventEP6PlayerP5ActorP5IItem");
+    original(this, player, killed, item);
+    ProfileScope scope("ClientWorld::SendKillEvent");
+    Publish(KillSentEvent{player, killed, item});
+}
+
+void ClientWorld::SendHealthUpdateEvent(Actor *actor, int32_t health)
+{
+    static auto original = Original<void (*)(ClientWorld *, Actor *, int32_t)>("_ZN11ClientWorld21SendHealthUpdateEventEP5Actori");
+    original(this, actor, health);
+    ProfileScope scope("ClientWorld::SendHealthUpdateEvent");
+    Publish(HealthSentEvent{actor, health});
+}
+
+void ClientWorld::SendRegionChangeEvent(Player *player, const std::string &region)
+{
+    static auto original = Original<void (*)(ClientWorld *, Player *, const std::string &)>("_ZN11ClientWorld21SendRegionChangeEventEP6PlayerRKNSt7__cxx1112basic_stringIcSt11char_traitsIcESaIcEEE");
+    original(this, player, region);
+    ProfileScope scope("ClientWorld::SendRegionChangeEvent");
+    Publish(RegionChangedEvent{player, &region});
+}
+
+// Player overrides Damage, so players never reach the Actor definition
+// through their vtable. If the override chains to Actor::Damage, the inner
+// call must not publish the hit a second time.
+static thread_local bool s_inPlayerDamage = false;
+
+void Actor::Damage(IActor *instigator, IItem *item, int32_t damage, DamageType type)
+{
+    static auto original = Original<void (*)(Actor *, IActor *, IItem *, int32_t, DamageType)>("_ZN5Actor6DamageEP6IActorP5IItemi10DamageType");
+    original(this, instigator, item, damage, type);
+    if(s_inPlayerDamage)
+        return;
+    ProfileScope scope("Actor::Damage");
+    Publish(DamageEvent{this, instigator, item, damage, type});
+}
+
+void Player::Damage(IActor *instigator, IItem *item, int32_t damage, DamageType type)
+{
+    static auto original = Original<void (*)(Player *, IActor *, IItem *, int32_t, DamageType)>("_ZN6Player6DamageEP6IActorP5IItemi10DamageType");
+    s_inPlayerDamage = true;
+    original(this, instigator, item, damage, type);
+    s_inPlayerDamage = false;
+    ProfileScope scope("Player::Damage");
+    Publish(DamageEvent{this, instigator, item, damage, type});
+}
+
+void Player::OnKillEvent(IPlayer *killer, IActor *killed, IItem *item)
+{
+    static auto original = Original<void (*)(Player *, IPlayer *, IActor *, IItem *)>("_ZN6Player11OnKillEventEP7IPlayerP6IActorP5IItem");
+    original(this, killer, killed, item);
+    ProfileScope scope("Player::OnKillEvent");
+    Publish(KillEvent{this, killer, killed, item});
+    if(killed == this->GetActorInterface() && this->IsLocalPlayer())
+        Publish(LocalDeathEvent{this, killer, item});
+}
+
+void Player::ReceiveChat(Player *from, const std::string &text)
+{
+    static auto original = Original<void (*)(Player *, Player *, const std::string &)>("_ZN6Player11ReceiveChatEPS_RKNSt7__cxx1112basic_stringIcSt11char_traitsIcESaIcEEE");
+    original(this, from, text);
+    ProfileScope scope("Player::ReceiveChat");
+    Publish(ChatEvent{this, from, &text});
+}
+
+void Player::OnTravelComplete(const std::string &destination)
+{
+    static auto original = Original<void (*)(Player *, const std::string &)>("_ZN6Player16OnTravelCompleteERKNSt7__cxx1112basic_stringIcSt11char_traitsIcESaIcEEE");
+    original(this, destination);
+    ProfileScope scope("Player::OnTravelComplete");
+    Publish(TravelCompletedEvent{this, &destination});
+}
+
+void Player::PerformStartQuest(IQuest *quest)
+{
+    static auto original = Original<void (*)(Player *, IQuest *)>("_ZN6Player17PerformStartQuestEP6IQuest");
+    original(this, quest);
+    ProfileScope scope("Player::PerformStartQuest");
+    Publish(QuestStartedEvent{this, quest});
+}
+
+void Player::PerformAdvanceQuestToState(IQuest *quest, IQuestState *state)
+{
+    static auto original = Original<void (*)(Player *, IQuest *, IQuestState *)>("_ZN6Player26PerformAdvanceQuestToStateEP6IQuestP11IQuestState");
+    original(this, quest, state);
+    ProfileScope scope("Player::PerformAdvanceQuestToState");
+    Publish(QuestAdvancedEvent{this, quest, state});
+}
+
+void Player::PerformCompleteQuest(IQuest *quest)
+{
+    static auto original = Original<void (*)(Player *, IQuest *)>("_ZN6Player20PerformCompleteQuestEP6IQuest");
+    original(this, quest);
+    ProfileScope scope("Player::PerformCompleteQuest");
+    Publish(QuestCompletedEvent{this, quest});
+}
+
+bool Player::PerformAddItem(IItem *item, uint32_t count, bool allowPartial)
+{
+    static auto original = Original<bool (*)(Player *, IItem *, uint32_t, bool)>("_ZN6Player14PerformAddItemEP5IItemjb");
+    bool added = original(this, item, count, allowPartial);
+    ProfileScope scope("Player::PerformAddItem");
+    if(added)
+        Publish(ItemAddedEvent{this, item, count});
+    return added;
+}
+
+bool Player::PerformRemoveItem(IItem *item, uint32_t count)
+{
+    static auto original = Original<bool (*)(Player *, IItem *, uint32_t)>("_ZN6Player17PerformRemoveItemEP5IItemj");
+    bool removed = original(this, item, count);
+    ProfileScope scope("Player::PerformRemoveItem");
+    if(removed)
+        Publish(ItemRemovedEvent{this, item, count});
+    return removed;
+}
+
 bool Player::CanJump()
 {
     std::cout << this->GetPlayerName() << std::endl;
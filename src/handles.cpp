@@ -0,0 +1,177 @@
+#include <chrono>
+#include <iostream>
+#include <map>
+#include "handles.h"
+
+ActorTable g_actorTable(1024);
+
+ActorTable::ActorTable(size_t capacity) : m_count(0), m_nextGeneration(1)
+{
+    size_t size = 16;
+    while(size < capacity)
+        size <<= 1;
+    m_slots.assign(size, Slot());
+    m_mask = size - 1;
+}
+
+const ActorTable::Slot * ActorTable::FindSlot(uint32_t id) const
+{
+    const Slot &slot = m_slots[id & m_mask];
+    if(slot.actor && slot.id == id)
+        return &slot;
+    if(m_overflow.empty())
+        return nullptr;
+
+    auto it = m_overflow.find(id);
+    return it == m_overflow.end() ? nullptr : &it->second;
+}
+
+void ActorTable::Place(const Slot &slot)
+{
+    Slot &home = m_slots[slot.id & m_mask];
+    if(!home.actor)
+        home = slot;
+    else
+        m_overflow[slot.id] = slot;
+}
+
+void ActorTable::Grow()
+{
+    std::vector<Slot> old;
+    old.swap(m_slots);
+    std::unordered_map<uint32_t, Slot> overflow;
+    overflow.swap(m_overflow);
+
+    m_slots.assign(old.size() * 2, Slot());
+    m_mask = m_slots.size() - 1;
+    for(const Slot &slot : old)
+    {
+        if(slot.actor)
+            this->Place(slot);
+    }
+    for(auto &entry : overflow)
+        this->Place(entry.second);
+}
+
+struct ActorHandle ActorTable::Insert(uint32_t id, Actor *actor)
+{
+    Slot *existing = (Slot*)this->FindSlot(id);
+    if(existing)
+    {
+        existing->actor = actor;
+        existing->generation = m_nextGeneration++;
+        struct ActorHandle handle = {id, existing->generation};
+        return handle;
+    }
+
+    if(m_count * 2 >= m_slots.size() || m_overflow.size() * 8 >= m_slots.size())
+        this->Grow();
+
+    Slot slot;
+    slot.id = id;
+    slot.generation = m_nextGeneration++;
+    slot.actor = actor;
+    this->Place(slot);
+    m_count++;
+
+    struct ActorHandle handle = {id, slot.generation};
+    return handle;
+}
+
+void ActorTable::Remove(uint32_t id)
+{
+    Slot &home = m_slots[id & m_mask];
+    if(home.actor && home.id == id)
+    {
+        home = Slot();
+        m_count--;
+    }
+    else if(m_overflow.erase(id))
+        m_count--;
+}
+
+void ActorTable::ChangeId(uint32_t oldId, uint32_t newId)
+{
+    const Slot *slot = this->FindSlot(oldId);
+    if(!slot)
+        return;
+
+    Actor *actor = slot->actor;
+    this->Remove(oldId);
+    this->Insert(newId, actor);
+}
+
+Actor * ActorTable::Find(uint32_t id) const
+{
+    const Slot *slot = this->FindSlot(id);
+    return slot ? slot->actor : nullptr;
+}
+
+Actor * ActorTable::Resolve(const struct ActorHandle &handle) const
+{
+    const Slot *slot = this->FindSlot(handle.id);
+    if(!slot || slot->generation != handle.generation)
+        return nullptr;
+    return slot->actor;
+}
+
+struct ActorHandle ActorTable::GetHandle(uint32_t id) const
+{
+    const Slot *slot = this->FindSlot(id);
+    struct ActorHandle handle = {id, slot ? slot->generation : 0};
+    return handle;
+}
+
+size_t ActorTable::GetCount() const
+{
+    return m_count;
+}
+
+void ActorTable::Clear()
+{
+    m_slots.assign(m_slots.size(), Slot());
+    m_overflow.clear();
+    m_count = 0;
+}
+
+void BenchmarkActorTable(size_t live, size_t iterations)
+{
+    // Sliding window of `live` actors: every iteration spawns one, destroys
+    // the oldest and looks up a few ids spread over the window. A handful of
+    // low ids stay alive throughout, like players do.
+    std::map<uint32_t, IActor*> map;
+    ActorTable table(16);
+    uint64_t mapSum = 0, tableSum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for(uint32_t id = 1; id <= 4; id++)
+        map[id] = (IActor*)(uintptr_t)(id * 16);
+    for(uint32_t id = 5; id < iterations + 5; id++)
+    {
+        map[id] = (IActor*)(uintptr_t)(id * 16);
+        if(id >= live + 5)
+            map.erase(id - live);
+        for(uint32_t k = 1; k <= 8; k++)
+        {
+            auto it = map.find(id - (k * live) / 9);
+            mapSum += it == map.end() ? 0 : (uintptr_t)it->second;
+        }
+    }
+    auto middle = std::chrono::steady_clock::now();
+    for(uint32_t id = 1; id <= 4; id++)
+        table.Insert(id, (Actor*)(uintptr_t)(id * 16));
+    for(uint32_t id = 5; id < iterations + 5; id++)
+    {
+        table.Insert(id, (Actor*)(uintptr_t)(id * 16));
+        if(id >= live + 5)
+            table.Remove(id - live);
+        for(uint32_t k = 1; k <= 8; k++)
+            tableSum += (uintptr_t)table.Find(id - (k * live) / 9);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double mapNs = std::chrono::duration<double, std::nano>(middle - start).count() / iterations;
+    double tableNs = std::chrono::duration<double, std::nano>(end - middle).count() / iterations;
+    std::cout << "map " << mapNs << " ns/iter, table " << tableNs << " ns/iter"
+        << (mapSum == tableSum ? "" : " (MISMATCH)") << std::endl;
+}
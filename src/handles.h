@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "classes.h"
+
+struct ActorHandle {
+    uint32_t id;
+    uint32_t generation;
+};
+
+// Mirror of World::m_actorsById kept in step by the world hooks. Ids come
+// from a counter, so the live ones sit in a narrow range and slotting them by
+// their low bits almost never collides; the rare id that does (a long-lived
+// player against a fresh spawn) goes to a small overflow map. Each insertion
+// gets a new generation, so a handle to a destroyed actor stops resolving.
+class ActorTable {
+    struct Slot {
+        uint32_t id;
+        uint32_t generation;
+        Actor *actor;
+    };
+
+    std::vector<Slot> m_slots;
+    std::unordered_map<uint32_t, Slot> m_overflow;
+    size_t m_mask;
+    size_t m_count;
+    uint32_t m_nextGeneration;
+
+    const Slot * FindSlot(uint32_t id) const;
+    void Place(const Slot &);
+    void Grow();
+
+  public:
+    ActorTable(size_t capacity);
+    struct ActorHandle Insert(uint32_t id, Actor *);
+    void Remove(uint32_t id);
+    void ChangeId(uint32_t oldId, uint32_t newId);
+    Actor * Find(uint32_t id) const;
+    Actor * Resolve(const struct ActorHandle &) const;
+    struct ActorHandle GetHandle(uint32_t id) const;
+    size_t GetCount() const;
+    void Clear();
+};
+
+void BenchmarkActorTable(size_t live, size_t iterations);
+
+extern ActorTable g_actorTable;
@@ -0,0 +1,396 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <queue>
+#include "nav.h"
+
+NavGraph g_nav(500.0f, 65536, 16, 8);
+NavTraveler g_navTraveler;
+
+static const float Unreachable = std::numeric_limits<float>::infinity();
+static const uint32_t NavMagic = 0x5641564e;
+static const uint32_t NavVersion = 1;
+
+NavGraph::NavGraph(float cellSize, size_t maxNodes, size_t maxEdges, size_t maxTrees)
+    : m_cellSize(cellSize), m_maxNodes(maxNodes), m_maxEdges(maxEdges), m_maxTrees(maxTrees),
+      m_clock(0), m_liveCount(0)
+{
+}
+
+static const uint64_t CellMask = (1 << 21) - 1;
+
+// Cells sharing a face, edge or corner. Coordinates wrap with the mask, so
+// the deltas are taken modulo it too.
+static bool Adjacent(uint64_t a, uint64_t b)
+{
+    for(int shift = 0; shift <= 42; shift += 21)
+    {
+        uint64_t delta = ((a >> shift) - (b >> shift)) & CellMask;
+        if(delta > 1 && delta != CellMask)
+            return false;
+    }
+    return true;
+}
+
+uint64_t NavGraph::CellOf(const struct Vector3 &pos) const
+{
+    const uint64_t mask = CellMask;
+    uint64_t x = (uint64_t)(int64_t)std::floor(pos.x / m_cellSize) & mask;
+    uint64_t y = (uint64_t)(int64_t)std::floor(pos.y / m_cellSize) & mask;
+    uint64_t z = (uint64_t)(int64_t)std::floor(pos.z / m_cellSize) & mask;
+    return (x << 42) | (y << 21) | z;
+}
+
+float NavGraph::Cost(uint32_t a, uint32_t b) const
+{
+    return Vector3::Distance(m_nodes[a].pos, m_nodes[b].pos);
+}
+
+uint32_t NavGraph::AddNode(const struct Vector3 &pos, uint64_t cell)
+{
+    if(m_liveCount >= m_maxNodes)
+        this->Evict();
+
+    uint32_t id;
+    if(!m_free.empty())
+    {
+        id = m_free.back();
+        m_free.pop_back();
+    }
+    else
+    {
+        id = m_nodes.size();
+        m_nodes.emplace_back();
+    }
+
+    Node &node = m_nodes[id];
+    node.pos = pos;
+    node.cell = cell;
+    node.lastVisit = m_clock;
+    node.live = true;
+    node.edges.clear();
+    m_cells[cell] = id;
+    m_liveCount++;
+    return id;
+}
+
+void NavGraph::AddEdge(uint32_t a, uint32_t b)
+{
+    if(a == b)
+        return;
+
+    std::vector<uint32_t> &ea = m_nodes[a].edges;
+    std::vector<uint32_t> &eb = m_nodes[b].edges;
+    if(std::find(ea.begin(), ea.end(), b) != ea.end())
+        return;
+    if(ea.size() >= m_maxEdges || eb.size() >= m_maxEdges)
+        return;
+    ea.push_back(b);
+    eb.push_back(a);
+
+    // A new edge only matters to a cached tree if it gives either end a
+    // shorter way to the destination.
+    float w = this->Cost(a, b);
+    m_trees.erase(std::remove_if(m_trees.begin(), m_trees.end(), [&](const PathTree &tree) {
+        float da = a < tree.dist.size() ? tree.dist[a] : Unreachable;
+        float db = b < tree.dist.size() ? tree.dist[b] : Unreachable;
+        return da + w < db || db + w < da;
+    }), m_trees.end());
+}
+
+void NavGraph::RemoveNode(uint32_t id)
+{
+    Node &node = m_nodes[id];
+    for(uint32_t other : node.edges)
+    {
+        std::vector<uint32_t> &edges = m_nodes[other].edges;
+        edges.erase(std::remove(edges.begin(), edges.end(), id), edges.end());
+    }
+    node.edges.clear();
+    node.edges.shrink_to_fit();
+    node.live = false;
+    m_cells.erase(node.cell);
+    m_free.push_back(id);
+    m_liveCount--;
+
+    for(auto it = m_lastNode.begin(); it != m_lastNode.end(); )
+    {
+        if(it->second == id)
+            it = m_lastNode.erase(it);
+        else
+            ++it;
+    }
+
+    m_trees.erase(std::remove_if(m_trees.begin(), m_trees.end(), [&](const PathTree &tree) {
+        return tree.dest == id || (id < tree.dist.size() && tree.dist[id] != Unreachable);
+    }), m_trees.end());
+}
+
+void NavGraph::Evict()
+{
+    // Drop the least recently visited eighth in one pass so eviction cost is
+    // amortized over many insertions.
+    std::vector<std::pair<uint32_t, uint32_t> > byAge;
+    byAge.reserve(m_liveCount);
+    for(uint32_t i = 0; i < m_nodes.size(); i++)
+    {
+        if(m_nodes[i].live)
+            byAge.push_back(std::make_pair(m_nodes[i].lastVisit, i));
+    }
+
+    size_t count = std::max<size_t>(1, byAge.size() / 8);
+    std::nth_element(byAge.begin(), byAge.begin() + count - 1, byAge.end());
+    for(size_t i = 0; i < count; i++)
+        this->RemoveNode(byAge[i].second);
+}
+
+void NavGraph::Record(uint32_t actorId, const struct Vector3 &pos)
+{
+    m_clock++;
+
+    uint64_t cell = this->CellOf(pos);
+    auto found = m_cells.find(cell);
+    uint32_t id = found != m_cells.end() ? found->second : this->AddNode(pos, cell);
+    m_nodes[id].lastVisit = m_clock;
+
+    // Teleports, respawns and position snaps jump across the map; only steps
+    // into a neighbouring cell are walkable.
+    auto last = m_lastNode.find(actorId);
+    if(last != m_lastNode.end() && last->second != id && Adjacent(m_nodes[last->second].cell, cell))
+        this->AddEdge(last->second, id);
+    m_lastNode[actorId] = id;
+}
+
+uint32_t NavGraph::Nearest(const struct Vector3 &pos) const
+{
+    uint32_t best = None;
+    float bestDist = Unreachable;
+
+    for(int dx = -1; dx <= 1; dx++)
+    {
+        for(int dy = -1; dy <= 1; dy++)
+        {
+            for(int dz = -1; dz <= 1; dz++)
+            {
+                Vector3 probe = Vector3(pos.x + dx * m_cellSize, pos.y + dy * m_cellSize, pos.z + dz * m_cellSize);
+                auto it = m_cells.find(this->CellOf(probe));
+                if(it == m_cells.end())
+                    continue;
+
+                float d = Vector3::DistanceSquared(pos, m_nodes[it->second].pos);
+                if(d < bestDist)
+                {
+                    best = it->second;
+                    bestDist = d;
+                }
+            }
+        }
+    }
+    if(best != None)
+        return best;
+
+    for(uint32_t i = 0; i < m_nodes.size(); i++)
+    {
+        if(!m_nodes[i].live)
+            continue;
+
+        float d = Vector3::DistanceSquared(pos, m_nodes[i].pos);
+        if(d < bestDist)
+        {
+            best = i;
+            bestDist = d;
+        }
+    }
+    return best;
+}
+
+NavGraph::PathTree & NavGraph::GetTree(uint32_t dest)
+{
+    for(PathTree &tree : m_trees)
+    {
+        if(tree.dest == dest)
+        {
+            tree.lastUsed = m_clock;
+            return tree;
+        }
+    }
+
+    if(m_trees.size() >= m_maxTrees)
+    {
+        auto oldest = std::min_element(m_trees.begin(), m_trees.end(), [](const PathTree &a, const PathTree &b) {
+            return a.lastUsed < b.lastUsed;
+        });
+        m_trees.erase(oldest);
+    }
+
+    m_trees.emplace_back();
+    PathTree &tree = m_trees.back();
+    tree.dest = dest;
+    tree.lastUsed = m_clock;
+    tree.dist.assign(m_nodes.size(), Unreachable);
+    tree.next.assign(m_nodes.size(), None);
+
+    typedef std::pair<float, uint32_t> Item;
+    std::priority_queue<Item, std::vector<Item>, std::greater<Item> > open;
+    tree.dist[dest] = 0;
+    open.push(Item(0, dest));
+    while(!open.empty())
+    {
+        Item top = open.top();
+        open.pop();
+        if(top.first > tree.dist[top.second])
+            continue;
+
+        for(uint32_t v : m_nodes[top.second].edges)
+        {
+            float d = top.first + this->Cost(top.second, v);
+            if(d < tree.dist[v])
+            {
+                tree.dist[v] = d;
+                tree.next[v] = top.second;
+                open.push(Item(d, v));
+            }
+        }
+    }
+    return tree;
+}
+
+bool NavGraph::Route(const struct Vector3 &from, const struct Vector3 &to, std::vector<struct Vector3> &hops)
+{
+    hops.clear();
+    uint32_t start = this->Nearest(from);
+    uint32_t dest = this->Nearest(to);
+    if(start == None || dest == None)
+        return false;
+
+    // Nearest falls back to any node at all; a route is only useful if both
+    // ends are next to the graph.
+    if(!Adjacent(this->CellOf(from), m_nodes[start].cell) || !Adjacent(this->CellOf(to), m_nodes[dest].cell))
+        return false;
+
+    // Nodes added after the tree was built are past its end. Any edge that
+    // linked one to the tree would have dropped the tree, so they can't reach.
+    const PathTree &tree = this->GetTree(dest);
+    if(start >= tree.dist.size() || tree.dist[start] == Unreachable)
+        return false;
+
+    for(uint32_t cur = start; cur != dest; )
+    {
+        cur = tree.next[cur];
+        hops.push_back(m_nodes[cur].pos);
+    }
+    hops.push_back(to);
+    return true;
+}
+
+bool NavGraph::Save(const std::string &path) const
+{
+    std::ofstream out(path, std::ios::binary);
+    if(!out)
+        return false;
+
+    std::vector<uint32_t> remap(m_nodes.size(), None);
+    uint32_t nodeCount = 0;
+    uint32_t edgeCount = 0;
+    for(uint32_t i = 0; i < m_nodes.size(); i++)
+    {
+        if(!m_nodes[i].live)
+            continue;
+        remap[i] = nodeCount++;
+        for(uint32_t j : m_nodes[i].edges)
+            edgeCount += i < j;
+    }
+
+    out.write((const char*)&NavMagic, 4);
+    out.write((const char*)&NavVersion, 4);
+    out.write((const char*)&m_cellSize, 4);
+    out.write((const char*)&nodeCount, 4);
+    out.write((const char*)&edgeCount, 4);
+    for(const Node &node : m_nodes)
+    {
+        if(node.live)
+            out.write((const char*)&node.pos, sizeof(node.pos));
+    }
+    for(uint32_t i = 0; i < m_nodes.size(); i++)
+    {
+        for(uint32_t j : m_nodes[i].edges)
+        {
+            if(i < j)
+            {
+                out.write((const char*)&remap[i], 4);
+                out.write((const char*)&remap[j], 4);
+            }
+        }
+    }
+    return out.good();
+}
+
+bool NavGraph::Load(const std::string &path)
+{
+    std::ifstream in(path, std::ios::binary);
+    uint32_t magic = 0, version = 0, nodeCount = 0, edgeCount = 0;
+    float cellSize = 0;
+    in.read((char*)&magic, 4);
+    in.read((char*)&version, 4);
+    in.read((char*)&cellSize, 4);
+    in.read((char*)&nodeCount, 4);
+    in.read((char*)&edgeCount, 4);
+    if(!in || magic != NavMagic || version != NavVersion || cellSize <= 0)
+        return false;
+
+    this->Clear();
+    m_cellSize = cellSize;
+
+    std::vector<uint32_t> ids(nodeCount, None);
+    for(uint32_t i = 0; i < nodeCount && in; i++)
+    {
+        Vector3 pos;
+        in.read((char*)&pos, sizeof(pos));
+        if(m_liveCount < m_maxNodes && !m_cells.count(this->CellOf(pos)))
+            ids[i] = this->AddNode(pos, this->CellOf(pos));
+    }
+    for(uint32_t i = 0; i < edgeCount && in; i++)
+    {
+        uint32_t a = None, b = None;
+        in.read((char*)&a, 4);
+        in.read((char*)&b, 4);
+        if(a < nodeCount && b < nodeCount && ids[a] != None && ids[b] != None)
+            this->AddEdge(ids[a], ids[b]);
+    }
+    return !in.fail();
+}
+
+void NavGraph::Clear()
+{
+    m_nodes.clear();
+    m_free.clear();
+    m_cells.clear();
+    m_lastNode.clear();
+    m_trees.clear();
+    m_liveCount = 0;
+}
+
+size_t NavGraph::GetNodeCount() const
+{
+    return m_liveCount;
+}
+
+NavTraveler::NavTraveler() : m_player(nullptr)
+{
+}
+
+void NavTraveler::Start(Player *player, const std::vector<struct Vector3> &hops)
+{
+    m_player = player;
+    m_hops.assign(hops.begin(), hops.end());
+}
+
+void NavTraveler::Tick()
+{
+    if(m_hops.empty())
+        return;
+
+    m_player->SetPosition(m_hops.front());
+    m_hops.pop_front();
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "classes.h"
+
+// Waypoint graph learned from where actors have been. Positions are bucketed
+// into cubic cells; each visited cell becomes a node at the first position
+// seen in it, and neighbouring cells visited one after the other by the same
+// actor are linked.
+// Routes come from shortest-path trees rooted at the destination, cached per
+// destination and dropped only when a graph change could shorten or break them.
+class NavGraph {
+    struct Node {
+        struct Vector3 pos;
+        uint64_t cell;
+        uint32_t lastVisit;
+        bool live;
+        std::vector<uint32_t> edges;
+    };
+
+    struct PathTree {
+        uint32_t dest;
+        uint32_t lastUsed;
+        std::vector<float> dist;
+        std::vector<uint32_t> next;
+    };
+
+    float m_cellSize;
+    size_t m_maxNodes;
+    size_t m_maxEdges;
+    size_t m_maxTrees;
+    uint32_t m_clock;
+    size_t m_liveCount;
+
+    std::vector<Node> m_nodes;
+    std::vector<uint32_t> m_free;
+    std::unordered_map<uint64_t, uint32_t> m_cells;
+    std::unordered_map<uint32_t, uint32_t> m_lastNode;
+    std::vector<PathTree> m_trees;
+
+    uint64_t CellOf(const struct Vector3 &) const;
+    uint32_t AddNode(const struct Vector3 &, uint64_t);
+    void AddEdge(uint32_t, uint32_t);
+    void RemoveNode(uint32_t);
+    void Evict();
+    uint32_t Nearest(const struct Vector3 &) const;
+    PathTree & GetTree(uint32_t);
+    float Cost(uint32_t, uint32_t) const;
+
+  public:
+    static constexpr uint32_t None = 0xffffffff;
+
+    NavGraph(float cellSize, size_t maxNodes, size_t maxEdges, size_t maxTrees);
+    void Record(uint32_t actorId, const struct Vector3 &);
+    bool Route(const struct Vector3 &from, const struct Vector3 &to, std::vector<struct Vector3> &hops);
+    bool Save(const std::string &) const;
+    bool Load(const std::string &);
+    void Clear();
+    size_t GetNodeCount() const;
+};
+
+// Plays a route back as one SetPosition hop per tick.
+class NavTraveler {
+    Player *m_player;
+    std::deque<struct Vector3> m_hops;
+
+  public:
+    NavTraveler();
+    void Start(Player *, const std::vector<struct Vector3> &);
+    void Tick();
+};
+
+extern NavGraph g_nav;
+extern NavTraveler g_navTraveler;
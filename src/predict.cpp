@@ -0,0 +1,116 @@
+#include <algorithm>
+#include "predict.h"
+
+struct ProjectileAccess : public Projectile {
+    static float GetLifetime(Projectile *p)
+    {
+        return p->*(&ProjectileAccess::m_lifetime);
+    }
+};
+
+TrajectoryPredictor::TrajectoryPredictor(size_t steps, float stepTime, float gravity)
+    : m_steps(steps), m_stepTime(stepTime), m_gravity(gravity),
+      m_capsuleRadius(42.0f), m_capsuleHalfHeight(96.0f)
+{
+}
+
+void TrajectoryPredictor::SetCapsule(float radius, float halfHeight)
+{
+    m_capsuleRadius = radius;
+    m_capsuleHalfHeight = halfHeight;
+}
+
+void TrajectoryPredictor::Load(const std::vector<Projectile*> &projectiles)
+{
+    size_t n = projectiles.size();
+    m_projectiles = projectiles;
+    m_px.resize(n); m_py.resize(n); m_pz.resize(n);
+    m_vx.resize(n); m_vy.resize(n); m_vz.resize(n);
+    m_radiusSquared.resize(n);
+    m_lifetime.resize(n);
+    m_owner.resize(n);
+
+    for(size_t i = 0; i < n; i++)
+    {
+        Projectile *p = projectiles[i];
+        Vector3 pos = p->GetPosition();
+        Vector3 vel = p->GetVelocity();
+        float radius = m_capsuleRadius + (p->HasSplashDamage() ? p->GetSplashRadius() : 0);
+
+        m_px[i] = pos.x; m_py[i] = pos.y; m_pz[i] = pos.z;
+        m_vx[i] = vel.x; m_vy[i] = vel.y; m_vz[i] = vel.z;
+        m_radiusSquared[i] = radius * radius;
+        m_lifetime[i] = ProjectileAccess::GetLifetime(p);
+        m_owner[i] = (uintptr_t)p->GetOwner();
+    }
+}
+
+std::vector<ProjectileThreat> TrajectoryPredictor::Predict(const std::vector<IPlayer*> &players)
+{
+    size_t n = m_projectiles.size();
+    const float never = 1e30f;
+    m_hitTime.assign(n, never);
+    m_hitPlayer.assign(n, -1);
+    m_reach.resize(n);
+
+    const float *__restrict px = m_px.data(), *__restrict py = m_py.data(), *__restrict pz = m_pz.data();
+    const float *__restrict vx = m_vx.data(), *__restrict vy = m_vy.data(), *__restrict vz = m_vz.data();
+    const float *__restrict radiusSquared = m_radiusSquared.data();
+    const float *__restrict lifetime = m_lifetime.data();
+    const uintptr_t *__restrict owner = m_owner.data();
+    float *__restrict reach = m_reach.data();
+    float *__restrict hitTime = m_hitTime.data();
+    int32_t *__restrict hitPlayer = m_hitPlayer.data();
+
+    for(size_t j = 0; j < players.size(); j++)
+    {
+        Player *player = (Player*)players[j];
+        Vector3 c = player->GetPosition();
+        uintptr_t self = (uintptr_t)player->GetActorInterface();
+        float h = m_capsuleHalfHeight;
+
+        for(size_t i = 0; i < n; i++)
+            reach[i] = owner[i] == self ? -1.0f : radiusSquared[i];
+
+        for(size_t s = 1; s <= m_steps; s++)
+        {
+            float t = s * m_stepTime;
+            float drop = 0.5f * m_gravity * t * t;
+
+            for(size_t i = 0; i < n; i++)
+            {
+                float dx = px[i] + vx[i] * t - c.x;
+                float dy = py[i] + vy[i] * t - c.y;
+                float dz = pz[i] + vz[i] * t - drop - c.z;
+                float cz = dz < -h ? -h : dz;
+                cz = cz > h ? h : cz;
+                float ez = dz - cz;
+                float d2 = dx * dx + dy * dy + ez * ez;
+
+                bool hit = (d2 <= reach[i]) & (t <= lifetime[i]) & (t < hitTime[i]);
+                hitTime[i] = hit ? t : hitTime[i];
+                hitPlayer[i] = hit ? (int32_t)j : hitPlayer[i];
+            }
+        }
+    }
+
+    std::vector<ProjectileThreat> threats;
+    for(size_t i = 0; i < n; i++)
+    {
+        if(hitPlayer[i] < 0)
+            continue;
+
+        float t = hitTime[i];
+        ProjectileThreat threat;
+        threat.projectile = m_projectiles[i];
+        threat.player = players[hitPlayer[i]];
+        threat.time = t;
+        threat.position = Vector3(px[i] + vx[i] * t, py[i] + vy[i] * t, pz[i] + vz[i] * t - 0.5f * m_gravity * t * t);
+        threats.push_back(threat);
+    }
+
+    std::sort(threats.begin(), threats.end(), [](const ProjectileThreat &a, const ProjectileThreat &b) {
+        return a.time < b.time;
+    });
+    return threats;
+}
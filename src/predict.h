@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "classes.h"
+
+struct ProjectileThreat {
+    Projectile *projectile;
+    IPlayer *player;
+    float time;
+    struct Vector3 position;
+};
+
+// Advances projectiles along their current velocity in fixed steps and reports
+// the earliest time each one enters a player's capsule (widened by splash).
+// State is kept as flat float arrays so the step loops vectorize.
+class TrajectoryPredictor {
+    size_t m_steps;
+    float m_stepTime;
+    float m_gravity;
+    float m_capsuleRadius;
+    float m_capsuleHalfHeight;
+
+    std::vector<Projectile*> m_projectiles;
+    std::vector<float> m_px, m_py, m_pz;
+    std::vector<float> m_vx, m_vy, m_vz;
+    std::vector<float> m_radiusSquared;
+    std::vector<float> m_lifetime;
+    std::vector<uintptr_t> m_owner;
+    std::vector<float> m_reach;
+    std::vector<float> m_hitTime;
+    std::vector<int32_t> m_hitPlayer;
+
+  public:
+    TrajectoryPredictor(size_t steps, float stepTime, float gravity);
+    void SetCapsule(float radius, float halfHeight);
+    void Load(const std::vector<Projectile*> &);
+    std::vector<ProjectileThreat> Predict(const std::vector<IPlayer*> &);
+};
@@ -0,0 +1,143 @@
+#include "events.h"
+#include "quests.h"
+
+QuestTracker g_quests(1024);
+
+static void OnQuestStarted(const QuestStartedEvent &event)
+{
+    if(event.player->IsLocalPlayer())
+        g_quests.OnStart(event.quest, event.quest->GetStartingState());
+}
+
+static void OnQuestAdvanced(const QuestAdvancedEvent &event)
+{
+    if(event.player->IsLocalPlayer())
+        g_quests.OnAdvance(event.quest, event.state);
+}
+
+static void OnQuestCompleted(const QuestCompletedEvent &event)
+{
+    if(event.player->IsLocalPlayer())
+        g_quests.OnComplete(event.quest);
+}
+
+SUBSCRIBE(QuestStartedEvent, OnQuestStarted);
+SUBSCRIBE(QuestAdvancedEvent, OnQuestAdvanced);
+SUBSCRIBE(QuestCompletedEvent, OnQuestCompleted);
+
+QuestTracker::QuestTracker(size_t journalCapacity)
+    : m_journalCapacity(journalCapacity), m_journalStart(0), m_lostThrough(0), m_sequence(0), m_tick(1), m_seeded(false)
+{
+    m_journal.reserve(journalCapacity);
+}
+
+uint32_t QuestTracker::IndexOf(IQuest *quest)
+{
+    auto found = m_index.find(quest);
+    if(found != m_index.end())
+        return found->second;
+
+    QuestEntry entry = {quest, nullptr, false, 0};
+    m_quests.push_back(entry);
+    m_index[quest] = m_quests.size() - 1;
+    return m_quests.size() - 1;
+}
+
+void QuestTracker::Record(uint32_t index, QuestChange change, IQuestState *state)
+{
+    m_sequence++;
+    m_quests[index].changedAt = m_sequence;
+
+    QuestChangeRecord record = {m_sequence, m_tick, index, change, state};
+    if(m_journal.size() < m_journalCapacity)
+    {
+        m_journal.push_back(record);
+        return;
+    }
+
+    m_lostThrough = m_journal[m_journalStart].sequence;
+    m_journal[m_journalStart] = record;
+    m_journalStart = (m_journalStart + 1) % m_journal.size();
+}
+
+void QuestTracker::Seed(Player *player)
+{
+    for(auto &entry : player->m_questStates)
+    {
+        uint32_t index = this->IndexOf(entry.first);
+        m_quests[index].state = entry.second.state;
+        m_quests[index].completed = player->IsQuestCompleted(entry.first);
+        m_quests[index].changedAt = m_sequence;
+    }
+    m_seeded = true;
+}
+
+bool QuestTracker::IsSeeded() const
+{
+    return m_seeded;
+}
+
+void QuestTracker::Tick()
+{
+    m_tick++;
+}
+
+uint64_t QuestTracker::GetTick() const
+{
+    return m_tick;
+}
+
+uint64_t QuestTracker::GetCursor() const
+{
+    return m_sequence;
+}
+
+void QuestTracker::OnStart(IQuest *quest, IQuestState *state)
+{
+    uint32_t index = this->IndexOf(quest);
+    m_quests[index].state = state;
+    m_quests[index].completed = false;
+    this->Record(index, QuestStarted, state);
+}
+
+void QuestTracker::OnAdvance(IQuest *quest, IQuestState *state)
+{
+    uint32_t index = this->IndexOf(quest);
+    m_quests[index].state = state;
+    this->Record(index, QuestAdvanced, state);
+}
+
+void QuestTracker::OnComplete(IQuest *quest)
+{
+    uint32_t index = this->IndexOf(quest);
+    m_quests[index].completed = true;
+    this->Record(index, QuestCompleted, m_quests[index].state);
+}
+
+const std::vector<QuestEntry> & QuestTracker::GetQuests() const
+{
+    return m_quests;
+}
+
+bool QuestTracker::GetChangesSince(uint64_t cursor, std::vector<QuestChangeRecord> &changes) const
+{
+    changes.clear();
+    if(cursor < m_lostThrough)
+        return false;
+
+    // Sequence numbers increase through the ring, so binary search for the
+    // first record after `cursor` and copy from there.
+    size_t n = m_journal.size();
+    size_t lo = 0, hi = n;
+    while(lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+        if(m_journal[(m_journalStart + mid) % n].sequence <= cursor)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    for(size_t i = lo; i < n; i++)
+        changes.push_back(m_journal[(m_journalStart + i) % n]);
+    return true;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "classes.h"
+
+enum QuestChange {QuestStarted, QuestAdvanced, QuestCompleted};
+
+struct QuestEntry {
+    IQuest *quest;
+    IQuestState *state;
+    bool completed;
+    uint64_t changedAt;
+};
+
+struct QuestChangeRecord {
+    uint64_t sequence;
+    uint64_t tick;
+    uint32_t index;
+    QuestChange change;
+    IQuestState *state;
+};
+
+// Flat mirror of the local player's m_questStates, seeded once and then kept
+// current from the Perform*Quest hooks. Every change is also appended to a
+// bounded journal. Each record takes the next sequence number, and callers
+// pass back the last one they saw to get only what came after it.
+class QuestTracker {
+    std::vector<QuestEntry> m_quests;
+    std::unordered_map<IQuest*, uint32_t> m_index;
+    std::vector<QuestChangeRecord> m_journal;
+    size_t m_journalCapacity;
+    size_t m_journalStart;
+    uint64_t m_lostThrough;
+    uint64_t m_sequence;
+    uint64_t m_tick;
+    bool m_seeded;
+
+    uint32_t IndexOf(IQuest *);
+    void Record(uint32_t index, QuestChange, IQuestState *);
+
+  public:
+    QuestTracker(size_t journalCapacity);
+    void Seed(Player *);
+    bool IsSeeded() const;
+    void Tick();
+    uint64_t GetTick() const;
+    uint64_t GetCursor() const;
+    void OnStart(IQuest *, IQuestState *);
+    void OnAdvance(IQuest *, IQuestState *);
+    void OnComplete(IQuest *);
+    const std::vector<QuestEntry> & GetQuests() const;
+    bool GetChangesSince(uint64_t cursor, std::vector<QuestChangeRecord> &changes) const;
+};
+
+extern QuestTracker g_quests;
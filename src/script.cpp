@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <functional>
+#include <new>
+#include "script.h"
+
+ScriptScheduler g_scripts;
+
+static const size_t ArenaClasses = 5;
+static const size_t ArenaSmallest = 128;
+static const size_t ArenaChunk = 64;
+
+struct FreeBlock {
+    FreeBlock *next;
+};
+
+static FreeBlock *s_freeLists[ArenaClasses];
+
+static size_t SizeClass(size_t size)
+{
+    size_t c = 0;
+    for(size_t block = ArenaSmallest; block < size; block <<= 1)
+        c++;
+    return c;
+}
+
+void * ScriptArena::Allocate(size_t size)
+{
+    size_t c = SizeClass(size);
+    if(c >= ArenaClasses)
+        return ::operator new(size);
+
+    if(!s_freeLists[c])
+    {
+        size_t block = ArenaSmallest << c;
+        char *chunk = (char*)::operator new(block * ArenaChunk);
+        for(size_t i = 0; i < ArenaChunk; i++)
+        {
+            FreeBlock *b = (FreeBlock*)(chunk + i * block);
+            b->next = s_freeLists[c];
+            s_freeLists[c] = b;
+        }
+    }
+
+    FreeBlock *b = s_freeLists[c];
+    s_freeLists[c] = b->next;
+    return b;
+}
+
+void ScriptArena::Free(void *p, size_t size)
+{
+    size_t c = SizeClass(size);
+    if(c >= ArenaClasses)
+    {
+        ::operator delete(p);
+        return;
+    }
+
+    FreeBlock *b = (FreeBlock*)p;
+    b->next = s_freeLists[c];
+    s_freeLists[c] = b;
+}
+
+Script::Script(std::coroutine_handle<promise_type> handle) : m_handle(handle)
+{
+}
+
+Script::Script(Script &&other) : m_handle(other.m_handle)
+{
+    other.m_handle = nullptr;
+}
+
+Script::~Script()
+{
+    if(m_handle)
+        m_handle.destroy();
+}
+
+std::coroutine_handle<> Script::Release()
+{
+    std::coroutine_handle<> handle = m_handle;
+    m_handle = nullptr;
+    return handle;
+}
+
+ScriptScheduler::ScriptScheduler() : m_time(0), m_order(0), m_live(0)
+{
+}
+
+void ScriptScheduler::Resume(std::coroutine_handle<> handle)
+{
+    handle.resume();
+    if(handle.done())
+    {
+        handle.destroy();
+        m_live--;
+    }
+}
+
+void ScriptScheduler::Start(Script script)
+{
+    m_live++;
+    this->Resume(script.Release());
+}
+
+void ScriptScheduler::Tick(float delta)
+{
+    m_time += delta;
+
+    m_running.swap(m_nextTick);
+    for(std::coroutine_handle<> handle : m_running)
+        this->Resume(handle);
+    m_running.clear();
+
+    while(!m_timers.empty() && m_timers.front().wake <= m_time)
+    {
+        std::pop_heap(m_timers.begin(), m_timers.end(), std::greater<Timer>());
+        std::coroutine_handle<> handle = m_timers.back().handle;
+        m_timers.pop_back();
+        this->Resume(handle);
+    }
+
+    // Waiters that resume may start waiting again, so poll a detached list.
+    m_polling.swap(m_waiters);
+    for(const Waiter &waiter : m_polling)
+    {
+        if(waiter.check(waiter.context))
+            this->Resume(waiter.handle);
+        else
+            m_waiters.push_back(waiter);
+    }
+    m_polling.clear();
+}
+
+void ScriptScheduler::WakeNextTick(std::coroutine_handle<> handle)
+{
+    m_nextTick.push_back(handle);
+}
+
+void ScriptScheduler::WakeAt(float time, std::coroutine_handle<> handle)
+{
+    Timer timer = {time, m_order++, handle};
+    m_timers.push_back(timer);
+    std::push_heap(m_timers.begin(), m_timers.end(), std::greater<Timer>());
+}
+
+void ScriptScheduler::WakeWhen(bool (*check)(void *), void *context, std::coroutine_handle<> handle)
+{
+    Waiter waiter = {check, context, handle};
+    m_waiters.push_back(waiter);
+}
+
+float ScriptScheduler::GetTime() const
+{
+    return m_time;
+}
+
+size_t ScriptScheduler::GetLiveCount() const
+{
+    return m_live;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <vector>
+
+// Coroutine scripts resumed from World::Tick. A script is any function
+// returning Script; inside it can
+//
+//   co_await NextTick();
+//   co_await Delay(0.5f);              // game time, summed from Tick's delta
+//   co_await Until([&] { return ...; });
+//
+// Frames are carved from size-classed free lists, so starting a script only
+// reaches malloc while the pool is still warming up.
+class ScriptArena {
+  public:
+    static void * Allocate(size_t);
+    static void Free(void *, size_t);
+};
+
+class Script {
+  public:
+    struct promise_type {
+        Script get_return_object()
+        {
+            return Script(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+
+        static void * operator new(size_t size) { return ScriptArena::Allocate(size); }
+        static void operator delete(void *p, size_t size) { ScriptArena::Free(p, size); }
+    };
+
+    explicit Script(std::coroutine_handle<promise_type>);
+    Script(Script &&);
+    Script(const Script &) = delete;
+    ~Script();
+    std::coroutine_handle<> Release();
+
+  private:
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+class ScriptScheduler {
+    struct Timer {
+        float wake;
+        uint64_t order;
+        std::coroutine_handle<> handle;
+        bool operator>(const Timer &other) const
+        {
+            return wake != other.wake ? wake > other.wake : order > other.order;
+        }
+    };
+
+    struct Waiter {
+        bool (*check)(void *);
+        void *context;
+        std::coroutine_handle<> handle;
+    };
+
+    float m_time;
+    uint64_t m_order;
+    size_t m_live;
+    std::vector<Timer> m_timers;
+    std::vector<std::coroutine_handle<> > m_nextTick, m_running;
+    std::vector<Waiter> m_waiters, m_polling;
+
+    void Resume(std::coroutine_handle<>);
+
+  public:
+    ScriptScheduler();
+    void Start(Script);
+    void Tick(float delta);
+    void WakeNextTick(std::coroutine_handle<>);
+    void WakeAt(float time, std::coroutine_handle<>);
+    void WakeWhen(bool (*check)(void *), void *context, std::coroutine_handle<>);
+    float GetTime() const;
+    size_t GetLiveCount() const;
+};
+
+extern ScriptScheduler g_scripts;
+
+struct NextTick {
+    bool await_ready() const { return false; }
+    void await_suspend(std::coroutine_handle<> handle) { g_scripts.WakeNextTick(handle); }
+    void await_resume() const {}
+};
+
+struct Delay {
+    float seconds;
+
+    explicit Delay(float s) : seconds(s) {}
+    bool await_ready() const { return seconds <= 0; }
+    void await_suspend(std::coroutine_handle<> handle) { g_scripts.WakeAt(g_scripts.GetTime() + seconds, handle); }
+    void await_resume() const {}
+};
+
+template<typename Predicate>
+struct Until {
+    Predicate predicate;
+
+    explicit Until(Predicate p) : predicate(p) {}
+    bool await_ready() { return predicate(); }
+    void await_suspend(std::coroutine_handle<> handle) { g_scripts.WakeWhen(&Until::Check, this, handle); }
+    void await_resume() const {}
+
+    static bool Check(void *self)
+    {
+        return ((Until *)self)->predicate();
+    }
+};
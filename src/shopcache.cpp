@@ -0,0 +1,73 @@
+#include <algorithm>
+#include "events.h"
+#include "shopcache.h"
+
+ShopCache g_shopCache;
+
+static void OnShopOpened(const ShopOpenedEvent &event)
+{
+    g_shopCache.Get(event.npc);
+}
+
+static void OnInventoryChanged(const ItemAddedEvent &)
+{
+    g_shopCache.Invalidate();
+}
+
+static void OnInventoryChanged(const ItemRemovedEvent &)
+{
+    g_shopCache.Invalidate();
+}
+
+SUBSCRIBE(ShopOpenedEvent, OnShopOpened);
+SUBSCRIBE(ItemAddedEvent, OnInventoryChanged);
+SUBSCRIBE(ItemRemovedEvent, OnInventoryChanged);
+
+const std::vector<ShopEntry> & ShopCache::Get(Actor *npc)
+{
+    auto found = m_shops.find(npc->GetId());
+    if(found != m_shops.end())
+        return found->second;
+
+    std::vector<ShopEntry> &entries = m_shops[npc->GetId()];
+    size_t count = 0;
+    IItem **items = npc->GetShopItems(count);
+    entries.reserve(count);
+    for(size_t i = 0; i < count; i++)
+    {
+        IItem *item = items[i];
+        ShopEntry entry;
+        entry.item = item;
+        entry.name = item->GetName();
+        entry.buyPrice = npc->GetBuyPriceForItem(item);
+        entry.sellPrice = npc->GetSellPriceForItem(item);
+        entry.rarity = item->GetItemRarity();
+        entry.damagePerSecond = item->GetDamagePerSecond();
+        entry.manaCost = item->GetManaCost();
+        entries.push_back(entry);
+    }
+    npc->FreeShopItems(items);
+    return entries;
+}
+
+void ShopCache::Invalidate()
+{
+    m_shops.clear();
+}
+
+std::vector<ShopEntry> ShopCache::Sorted(const std::vector<ShopEntry> &entries, ShopOrder order)
+{
+    std::vector<ShopEntry> sorted = entries;
+    std::stable_sort(sorted.begin(), sorted.end(), [order](const ShopEntry &a, const ShopEntry &b) {
+        switch(order)
+        {
+            case ShopByBuyPrice: return a.buyPrice < b.buyPrice;
+            case ShopByRarity: return a.rarity > b.rarity;
+            case ShopByDamagePerSecond: return a.damagePerSecond > b.damagePerSecond;
+            case ShopByDamagePerCoin:
+                return (int64_t)a.damagePerSecond * std::max(b.buyPrice, 1) > (int64_t)b.damagePerSecond * std::max(a.buyPrice, 1);
+        }
+        return false;
+    });
+    return sorted;
+}
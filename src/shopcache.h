@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "classes.h"
+
+enum ShopOrder {ShopByBuyPrice, ShopByRarity, ShopByDamagePerSecond, ShopByDamagePerCoin};
+
+struct ShopEntry {
+    IItem *item;
+    const char *name;
+    int32_t buyPrice;
+    int32_t sellPrice;
+    ItemRarity rarity;
+    int32_t damagePerSecond;
+    int32_t manaCost;
+};
+
+// Per-NPC copy of what a shop sells, read once through the virtual item and
+// pricing calls. Prices depend on what the player already owns, so any
+// inventory change drops every shop and the next access reads it again.
+class ShopCache {
+    std::unordered_map<uint32_t, std::vector<ShopEntry> > m_shops;
+
+  public:
+    const std::vector<ShopEntry> & Get(Actor *npc);
+    void Invalidate();
+    static std::vector<ShopEntry> Sorted(const std::vector<ShopEntry> &, ShopOrder);
+};
+
+extern ShopCache g_shopCache;
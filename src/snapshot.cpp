@@ -0,0 +1,400 @@
+#include <cstring>
+#include <set>
+#include "events.h"
+#include "snapshot.h"
+
+SnapshotRegistry g_snapshotRegistry;
+std::map<std::string, PlayerSnapshot> g_snapshots;
+
+static void OnItemAdded(const ItemAddedEvent &event)
+{
+    g_snapshotRegistry.AddItem(event.item);
+}
+
+static void OnQuestStarted(const QuestStartedEvent &event)
+{
+    g_snapshotRegistry.AddQuest(event.quest);
+}
+
+SUBSCRIBE(ItemAddedEvent, OnItemAdded);
+SUBSCRIBE(QuestStartedEvent, OnQuestStarted);
+
+void SnapshotRegistry::AddItem(IItem *item)
+{
+    if(item)
+        m_items.emplace(item->GetName(), item);
+}
+
+void SnapshotRegistry::AddQuest(IQuest *quest)
+{
+    if(quest)
+        m_quests.emplace(quest->GetName(), quest);
+}
+
+IItem * SnapshotRegistry::FindItem(const std::string &name) const
+{
+    auto found = m_items.find(name);
+    return found != m_items.end() ? found->second : nullptr;
+}
+
+IQuest * SnapshotRegistry::FindQuest(const std::string &name) const
+{
+    auto found = m_quests.find(name);
+    return found != m_quests.end() ? found->second : nullptr;
+}
+
+class SnapshotWriter {
+    std::vector<uint8_t> &m_out;
+
+  public:
+    SnapshotWriter(std::vector<uint8_t> &out) : m_out(out) {}
+
+    void PutU32(uint32_t value)
+    {
+        uint8_t *p = (uint8_t*)&value;
+        m_out.insert(m_out.end(), p, p + 4);
+    }
+
+    void PutString(const char *value)
+    {
+        size_t length = value ? strlen(value) : 0;
+        this->PutU32(length);
+        m_out.insert(m_out.end(), (const uint8_t*)value, (const uint8_t*)value + length);
+    }
+};
+
+class SnapshotReader {
+    const uint8_t *m_p;
+    const uint8_t *m_end;
+
+  public:
+    SnapshotReader(const std::vector<uint8_t> &in) : m_p(in.data()), m_end(in.data() + in.size()) {}
+
+    bool GetU32(uint32_t &value)
+    {
+        if(m_end - m_p < 4)
+            return false;
+        memcpy(&value, m_p, 4);
+        m_p += 4;
+        return true;
+    }
+
+    bool GetString(std::string &value)
+    {
+        uint32_t length;
+        if(!this->GetU32(length) || (size_t)(m_end - m_p) < length)
+            return false;
+        value.assign((const char*)m_p, length);
+        m_p += length;
+        return true;
+    }
+
+    bool GetBytes(std::vector<uint8_t> &value, uint32_t length)
+    {
+        if((size_t)(m_end - m_p) < length)
+            return false;
+        value.assign(m_p, m_p + length);
+        m_p += length;
+        return true;
+    }
+};
+
+static uint64_t HashBytes(const std::vector<uint8_t> &bytes)
+{
+    uint64_t h = 14695981039346656037ull;
+    for(uint8_t b : bytes)
+        h = (h ^ b) * 1099511628211ull;
+    return h;
+}
+
+static void WriteSection(Player *player, SnapshotSection section, std::vector<uint8_t> &out)
+{
+    SnapshotWriter writer(out);
+    if(section == SnapshotItems)
+    {
+        writer.PutU32(player->m_inventory.size());
+        for(auto &entry : player->m_inventory)
+        {
+            g_snapshotRegistry.AddItem(entry.first);
+            writer.PutString(entry.first->GetName());
+            writer.PutU32(entry.second.count);
+            writer.PutU32(entry.second.loadedAmmo);
+        }
+    }
+    if(section == SnapshotQuests)
+    {
+        writer.PutU32(player->m_questStates.size());
+        for(auto &entry : player->m_questStates)
+        {
+            g_snapshotRegistry.AddQuest(entry.first);
+            writer.PutString(entry.first->GetName());
+            writer.PutString(entry.second.state ? entry.second.state->GetName() : nullptr);
+            writer.PutU32(entry.second.count);
+            writer.PutU32(player->IsQuestCompleted(entry.first));
+        }
+    }
+    if(section == SnapshotPickups)
+    {
+        writer.PutU32(player->m_pickups.size());
+        for(const std::string &name : player->m_pickups)
+            writer.PutString(name.c_str());
+    }
+    if(section == SnapshotStatus)
+    {
+        for(IItem *item : player->m_equipped)
+        {
+            g_snapshotRegistry.AddItem(item);
+            writer.PutString(item ? item->GetName() : nullptr);
+        }
+        writer.PutU32(player->m_currentSlot);
+        writer.PutU32(player->m_mana);
+        writer.PutU32(player->GetHealth());
+        g_snapshotRegistry.AddQuest(player->m_currentQuest);
+        writer.PutString(player->m_currentQuest ? player->m_currentQuest->GetName() : nullptr);
+    }
+}
+
+PlayerSnapshot PlayerSnapshot::Capture(Player *player, const PlayerSnapshot *previous)
+{
+    PlayerSnapshot snapshot;
+    for(size_t i = 0; i < SnapshotSections; i++)
+    {
+        std::vector<uint8_t> bytes;
+        bytes.reserve(previous && previous->m_sections[i] ? previous->m_sections[i]->bytes.size() : 256);
+        WriteSection(player, (SnapshotSection)i, bytes);
+
+        uint64_t hash = HashBytes(bytes);
+        const std::shared_ptr<const SnapshotBlob> *shared = previous ? &previous->m_sections[i] : nullptr;
+        if(shared && *shared && (*shared)->hash == hash && (*shared)->bytes == bytes)
+            snapshot.m_sections[i] = *shared;
+        else
+            snapshot.m_sections[i] = std::make_shared<const SnapshotBlob>(SnapshotBlob{hash, std::move(bytes)});
+    }
+    return snapshot;
+}
+
+static uint32_t RestoreItems(Player *player, SnapshotReader &reader)
+{
+    uint32_t skipped = 0, count = 0;
+    std::map<IItem*, ItemCountInfo> target;
+    reader.GetU32(count);
+    for(uint32_t i = 0; i < count; i++)
+    {
+        std::string name;
+        ItemCountInfo info;
+        if(!reader.GetString(name) || !reader.GetU32(info.count) || !reader.GetU32(info.loadedAmmo))
+            return skipped + 1;
+
+        IItem *item = g_snapshotRegistry.FindItem(name);
+        if(item)
+            target[item] = info;
+        else
+            skipped++;
+    }
+
+    // Removing changes m_inventory, so decide everything before touching it.
+    std::vector<std::pair<IItem*, uint32_t> > removals;
+    for(auto &entry : player->m_inventory)
+    {
+        auto wanted = target.find(entry.first);
+        uint32_t want = wanted != target.end() ? wanted->second.count : 0;
+        if(entry.second.count > want)
+            removals.push_back(std::make_pair(entry.first, entry.second.count - want));
+    }
+    for(auto &removal : removals)
+        player->PerformRemoveItem(removal.first, removal.second);
+
+    for(auto &entry : target)
+    {
+        auto current = player->m_inventory.find(entry.first);
+        uint32_t have = current != player->m_inventory.end() ? current->second.count : 0;
+        if(entry.second.count > have)
+            player->PerformAddItem(entry.first, entry.second.count - have, true);
+        if(player->GetLoadedAmmo(entry.first) != entry.second.loadedAmmo)
+            player->PerformSetLoadedAmmo(entry.first, entry.second.loadedAmmo);
+    }
+    return skipped;
+}
+
+static uint32_t RestoreQuests(Player *player, SnapshotReader &reader)
+{
+    uint32_t skipped = 0, count = 0;
+    std::set<IQuest*> wanted;
+    reader.GetU32(count);
+    for(uint32_t i = 0; i < count; i++)
+    {
+        std::string name, stateName;
+        uint32_t stateCount, completed;
+        if(!reader.GetString(name) || !reader.GetString(stateName) || !reader.GetU32(stateCount) || !reader.GetU32(completed))
+            return skipped + 1;
+
+        IQuest *quest = g_snapshotRegistry.FindQuest(name);
+        if(!quest)
+        {
+            skipped++;
+            continue;
+        }
+        wanted.insert(quest);
+
+        if(!player->IsQuestStarted(quest))
+            player->PerformStartQuest(quest);
+        IQuestState *state = stateName.empty() ? nullptr : quest->GetStateByName(stateName.c_str());
+        if(state && player->GetStateForQuest(quest).state != state)
+            player->PerformAdvanceQuestToState(quest, state);
+        // There is no setter for a state's progress count.
+        skipped += player->GetStateForQuest(quest).count != stateCount;
+        if(completed && !player->IsQuestCompleted(quest))
+            player->PerformCompleteQuest(quest);
+        else if(!completed && player->IsQuestCompleted(quest))
+            skipped++;
+    }
+
+    for(auto &entry : player->m_questStates)
+        skipped += !wanted.count(entry.first);
+    return skipped;
+}
+
+static uint32_t RestorePickups(Player *player, SnapshotReader &reader)
+{
+    uint32_t skipped = 0, count = 0;
+    std::set<std::string> wanted;
+    reader.GetU32(count);
+    for(uint32_t i = 0; i < count; i++)
+    {
+        std::string name;
+        if(!reader.GetString(name))
+            return skipped + 1;
+
+        if(!player->m_pickups.count(name))
+            player->PerformMarkAsPickedUp(name);
+        wanted.insert(name);
+    }
+
+    for(const std::string &name : player->m_pickups)
+        skipped += !wanted.count(name);
+    return skipped;
+}
+
+static uint32_t RestoreStatus(Player *player, SnapshotReader &reader)
+{
+    uint32_t skipped = 0;
+    for(size_t slot = 0; slot < 10; slot++)
+    {
+        std::string name;
+        if(!reader.GetString(name))
+            return skipped + 1;
+
+        IItem *item = name.empty() ? nullptr : g_snapshotRegistry.FindItem(name);
+        if(!name.empty() && !item)
+            skipped++;
+        else if(player->m_equipped[slot] != item)
+            player->PerformEquipItem(slot, item);
+    }
+
+    uint32_t slot, mana, health;
+    std::string quest;
+    if(!reader.GetU32(slot) || !reader.GetU32(mana) || !reader.GetU32(health) || !reader.GetString(quest))
+        return skipped + 1;
+
+    // Deserialize only checks the framing, so the slot may be anything.
+    if(slot < 10)
+        player->PerformSetCurrentSlot(slot);
+    else
+        skipped++;
+    player->PerformSetMana(mana);
+    player->PerformSetHealth(health);
+    if(!quest.empty())
+        player->PerformSetCurrentQuest(g_snapshotRegistry.FindQuest(quest));
+    return skipped;
+}
+
+uint32_t PlayerSnapshot::Restore(Player *player) const
+{
+    uint32_t skipped = 0;
+    for(size_t i = 0; i < SnapshotSections; i++)
+    {
+        if(!m_sections[i])
+            continue;
+
+        SnapshotReader reader(m_sections[i]->bytes);
+        if(i == SnapshotItems)
+            skipped += RestoreItems(player, reader);
+        if(i == SnapshotQuests)
+            skipped += RestoreQuests(player, reader);
+        if(i == SnapshotPickups)
+            skipped += RestorePickups(player, reader);
+        if(i == SnapshotStatus)
+            skipped += RestoreStatus(player, reader);
+    }
+    return skipped;
+}
+
+uint32_t PlayerSnapshot::Diff(const PlayerSnapshot &other) const
+{
+    uint32_t changed = 0;
+    for(size_t i = 0; i < SnapshotSections; i++)
+    {
+        const SnapshotBlob *a = m_sections[i].get();
+        const SnapshotBlob *b = other.m_sections[i].get();
+        if(a == b)
+            continue;
+        if(!a || !b || a->hash != b->hash || a->bytes != b->bytes)
+            changed |= 1 << i;
+    }
+    return changed;
+}
+
+bool PlayerSnapshot::Shares(const PlayerSnapshot &other, SnapshotSection section) const
+{
+    return m_sections[section] && m_sections[section] == other.m_sections[section];
+}
+
+size_t PlayerSnapshot::GetSize() const
+{
+    size_t size = 0;
+    for(auto &section : m_sections)
+        size += section ? section->bytes.size() : 0;
+    return size;
+}
+
+std::vector<uint8_t> PlayerSnapshot::Serialize() const
+{
+    std::vector<uint8_t> out;
+    out.reserve(12 + SnapshotSections * 4 + this->GetSize());
+
+    SnapshotWriter writer(out);
+    writer.PutU32(Magic);
+    writer.PutU32(Version);
+    writer.PutU32(SnapshotSections);
+    for(auto &section : m_sections)
+    {
+        writer.PutU32(section ? section->bytes.size() : 0);
+        if(section)
+            out.insert(out.end(), section->bytes.begin(), section->bytes.end());
+    }
+    return out;
+}
+
+bool PlayerSnapshot::Deserialize(const std::vector<uint8_t> &in)
+{
+    SnapshotReader reader(in);
+    uint32_t magic, version, sections;
+    if(!reader.GetU32(magic) || !reader.GetU32(version) || !reader.GetU32(sections))
+        return false;
+    if(magic != Magic || version != Version || sections != SnapshotSections)
+        return false;
+
+    PlayerSnapshot parsed;
+    for(auto &section : parsed.m_sections)
+    {
+        uint32_t length;
+        std::vector<uint8_t> bytes;
+        if(!reader.GetU32(length) || !reader.GetBytes(bytes, length))
+            return false;
+
+        uint64_t hash = HashBytes(bytes);
+        section = std::make_shared<const SnapshotBlob>(SnapshotBlob{hash, std::move(bytes)});
+    }
+    *this = parsed;
+    return true;
+}
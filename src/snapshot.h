@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "classes.h"
+
+enum SnapshotSection {SnapshotItems, SnapshotQuests, SnapshotPickups, SnapshotStatus, SnapshotSections};
+
+// One serialized part of a player's state. Sections are immutable once built
+// and shared between snapshots, so a checkpoint only pays for what changed.
+struct SnapshotBlob {
+    uint64_t hash;
+    std::vector<uint8_t> bytes;
+};
+
+// A player's items, quests, pickups and status (equipment, slot, mana,
+// health, current quest) as name-keyed binary sections. Capture reuses any
+// section of `previous` whose bytes come out the same. Restore goes through
+// the Perform* setters; quests and pickups can only move forward, so state
+// the snapshot doesn't have is counted in the result rather than undone.
+class PlayerSnapshot {
+    std::shared_ptr<const SnapshotBlob> m_sections[SnapshotSections];
+
+  public:
+    static constexpr uint32_t Magic = 0x504e5350;
+    static constexpr uint32_t Version = 1;
+
+    static PlayerSnapshot Capture(Player *, const PlayerSnapshot *previous);
+    uint32_t Restore(Player *) const;
+    uint32_t Diff(const PlayerSnapshot &) const;
+    bool Shares(const PlayerSnapshot &, SnapshotSection) const;
+    size_t GetSize() const;
+    std::vector<uint8_t> Serialize() const;
+    bool Deserialize(const std::vector<uint8_t> &);
+};
+
+// Snapshots are keyed by name, so restoring needs a way back from names to
+// the game's objects. Every item and quest seen this session is recorded.
+class SnapshotRegistry {
+    std::unordered_map<std::string, IItem*> m_items;
+    std::unordered_map<std::string, IQuest*> m_quests;
+
+  public:
+    void AddItem(IItem *);
+    void AddQuest(IQuest *);
+    IItem * FindItem(const std::string &) const;
+    IQuest * FindQuest(const std::string &) const;
+};
+
+extern SnapshotRegistry g_snapshotRegistry;
+extern std::map<std::string, PlayerSnapshot> g_snapshots;
@@ -0,0 +1,113 @@
+#include "handles.h"
+#include "visibility.h"
+
+VisibilityService g_visibility(16, 0.5f, 50.0f);
+
+VisibilityService::VisibilityService(size_t tracesPerTick, float maxAge, float moveTolerance)
+    : m_tracesPerTick(tracesPerTick), m_maxAge(maxAge),
+      m_moveToleranceSquared(moveTolerance * moveTolerance), m_time(0), m_sweepTimer(0)
+{
+}
+
+uint64_t VisibilityService::Key(uint32_t source, uint32_t target)
+{
+    return ((uint64_t)source << 32) | target;
+}
+
+bool VisibilityService::IsStale(const Entry &entry, Actor *source, Actor *target) const
+{
+    if(!entry.traced || m_time - entry.tracedAt > m_maxAge)
+        return true;
+    if(Vector3::DistanceSquared(entry.sourcePos, source->GetPosition()) > m_moveToleranceSquared)
+        return true;
+    return Vector3::DistanceSquared(entry.targetPos, target->GetPosition()) > m_moveToleranceSquared;
+}
+
+struct Visibility VisibilityService::Query(Actor *source, Actor *target)
+{
+    uint64_t key = Key(source->GetId(), target->GetId());
+    auto it = m_entries.find(key);
+    if(it == m_entries.end())
+    {
+        Entry entry = {};
+        entry.source = source->GetId();
+        entry.target = target->GetId();
+        it = m_entries.emplace(key, entry).first;
+    }
+
+    Entry &entry = it->second;
+    entry.queriedAt = m_time;
+    if(!entry.queued && this->IsStale(entry, source, target))
+    {
+        entry.queued = true;
+        m_pending.push_back(key);
+    }
+
+    struct Visibility result;
+    result.known = entry.traced;
+    result.visible = entry.visible;
+    result.age = entry.traced ? m_time - entry.tracedAt : 0;
+    return result;
+}
+
+void VisibilityService::Tick(float delta)
+{
+    m_time += delta;
+
+    for(size_t traces = 0; traces < m_tracesPerTick && !m_pending.empty(); )
+    {
+        uint64_t key = m_pending.front();
+        m_pending.pop_front();
+
+        auto it = m_entries.find(key);
+        if(it == m_entries.end())
+            continue;
+
+        Entry &entry = it->second;
+        Actor *source = g_actorTable.Find(entry.source);
+        Actor *target = g_actorTable.Find(entry.target);
+        if(!source || !target)
+        {
+            m_entries.erase(it);
+            continue;
+        }
+
+        entry.sourcePos = source->GetPosition();
+        entry.targetPos = target->GetPosition();
+        IActor *hit = source->LineTraceTo(entry.targetPos);
+        entry.visible = !hit || hit == target;
+        entry.traced = true;
+        entry.tracedAt = m_time;
+        entry.queued = false;
+        traces++;
+    }
+
+    m_sweepTimer += delta;
+    if(m_sweepTimer > 10 * m_maxAge)
+    {
+        m_sweepTimer = 0;
+        this->Sweep();
+    }
+}
+
+void VisibilityService::Sweep()
+{
+    for(auto it = m_entries.begin(); it != m_entries.end(); )
+    {
+        if(!it->second.queued && m_time - it->second.queriedAt > 10 * m_maxAge)
+            it = m_entries.erase(it);
+        else
+            ++it;
+    }
+}
+
+void VisibilityService::Clear()
+{
+    m_entries.clear();
+    m_pending.clear();
+}
+
+size_t VisibilityService::GetPendingCount() const
+{
+    return m_pending.size();
+}
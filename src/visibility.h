@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include "classes.h"
+
+struct Visibility {
+    bool known;
+    bool visible;
+    float age;
+};
+
+// Line-of-sight cache. Query() never traces: it answers from the last trace
+// and queues a refresh when the answer is too old or either actor moved.
+// Tick() drains the queue, at most m_tracesPerTick LineTraceTo calls a frame.
+class VisibilityService {
+    struct Entry {
+        uint32_t source;
+        uint32_t target;
+        struct Vector3 sourcePos;
+        struct Vector3 targetPos;
+        float tracedAt;
+        float queriedAt;
+        bool traced;
+        bool visible;
+        bool queued;
+    };
+
+    std::unordered_map<uint64_t, Entry> m_entries;
+    std::deque<uint64_t> m_pending;
+    size_t m_tracesPerTick;
+    float m_maxAge;
+    float m_moveToleranceSquared;
+    float m_time;
+    float m_sweepTimer;
+
+    static uint64_t Key(uint32_t source, uint32_t target);
+    bool IsStale(const Entry &, Actor *, Actor *) const;
+    void Sweep();
+
+  public:
+    VisibilityService(size_t tracesPerTick, float maxAge, float moveTolerance);
+    struct Visibility Query(Actor *source, Actor *target);
+    void Tick(float);
+    void Clear();
+    size_t GetPendingCount() const;
+};
+
+extern VisibilityService g_visibility;